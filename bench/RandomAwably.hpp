@@ -0,0 +1,65 @@
+#pragma once
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+* @brief The shape of the code randomAwably generates.
+*/
+struct RandomAwablyOptions {
+    size_t lines = 0;               // Stops after this many instructions, if set
+    size_t bytes = 0;               // Stops once the code is this large, if set, the code is empty if neither is
+    size_t perLine = 1;             // Instructions per line, separated by "; "
+    bool strings = false;           // Also blows strings like "blw S(A)"
+    bool jumps = true;              // Uses lbl and jmp, without them the code only runs straight through
+    bool terminate = true;          // Uses trm
+    size_t invalidEvery = 0;        // Every this many instructions is the invalid "blw x", if set
+};
+
+/**
+* @brief Generates random legacy Awably, the same code for the same options.
+*/
+inline std::string randomAwably(const RandomAwablyOptions& options) {
+    static const std::vector<std::string> plain = { "nop", "prn", "pr1", "red", "r3d", "pop", "dpl", "mrg", "4dd", "sub", "mul", "div", "cnt", "eql", "lss", "gr8", "trm" };
+    static const std::vector<std::string> withJumps = { "sbm", "srn", "lbl", "jmp" };
+    static const std::vector<std::string> withoutJumps = { "srn", "sbm" };
+    static const std::vector<std::string> tokens = { "A", "w", "0", "space", "\\n", "!" };
+
+    enum Kind { Number, String, Operand, Plain };
+    static constexpr Kind withStrings[] = { Number, String, Operand, Plain };
+    static constexpr Kind withoutStrings[] = { Number, Operand, Plain };
+
+    const std::vector<std::string>& u5 = options.jumps ? withJumps : withoutJumps;
+    const size_t plainCount = plain.size() - (options.terminate ? 0 : 1);
+
+    std::string code;
+    if (!options.lines && !options.bytes) {
+        return code;
+    }
+
+    std::mt19937 rng(42);
+    code.reserve(options.bytes + 16);
+    for (size_t i = 0; (!options.lines || i < options.lines) && (!options.bytes || code.size() < options.bytes); i++) {
+        if (options.invalidEvery && i % options.invalidEvery == options.invalidEvery - 1) {
+            code += "blw x";
+        }
+        else {
+            switch (options.strings ? withStrings[rng() % 4] : withoutStrings[rng() % 3]) {
+            case Number:
+                code += "blw " + std::to_string(static_cast<int>(rng() % 256) - 128);
+                break;
+            case String:
+                code += "blw S(" + tokens[rng() % tokens.size()] + ")";
+                break;
+            case Operand:
+                code += u5[rng() % u5.size()] + " " + std::to_string(rng() % 32);
+                break;
+            default:
+                code += plain[rng() % plainCount];
+                break;
+            }
+        }
+        code += (i % options.perLine == options.perLine - 1) ? "\n" : "; ";
+    }
+    return code;
+}
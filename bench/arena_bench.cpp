@@ -0,0 +1,74 @@
+#include "../src/AwaInterpreter.hpp"
+#include "../src/Awabler.hpp"
+#include <chrono>
+#include <thread>
+
+/**
+* @brief Runs the jobs on threadCount threads, every thread reusing one VM.
+*
+* @return The executed steps per second.
+*/
+static double measure(const CompiledProgram& program, unsigned int threadCount, size_t jobsPerThread, bool arena) {
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> steps(threadCount);
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            NullWarningSink warnings;
+            StringInput input("awa awawa awa wawa");
+            StringOutput output;
+            VmState state;
+            if (!arena) state.arena.reset();
+
+            for (size_t job = 0; job < jobsPerThread; job++) {
+                state.reset();
+                output.output.clear();
+                AwaInterpreter::execute(program, state, { input, output, warnings });
+                steps[t] += state.executionStep;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    for (uint64_t s : steps) total += s;
+    return total / seconds;
+}
+
+/**
+* @brief Compares the per-VM arena against the global heap on an allocation heavy program, on 1 and 32 threads.
+*
+* Usage: arena_bench [Jobs]
+*/
+int main(int argc, char* argv[]) {
+    size_t jobs = (argc > 1) ? std::stoul(argv[1]) : 3200;
+
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    // [counter]: divisions, short merges and merged strings are submerged below the counter, the reset releases them
+    std::shared_ptr<const CompiledProgram> program = AwaInterpreter::compileAwably(
+        "blw 100\n"
+        "lbl 0; blw 0; eql; jmp 1; pop\n"
+        "blw 50; blw 7; div; blw 2; div; sbm 1\n"
+        "blw 1; blw 2; mrg; blw 3; mrg; sbm 1\n"
+        "red; dpl; mrg; sbm 1\n"
+        "blw 1; sbm 1; sub; jmp 0\n"
+        "lbl 1\n");
+
+    std::cout << std::setw(8) << "Threads" << std::setw(18) << "Heap Msteps/s" << std::setw(18) << "Arena Msteps/s" << std::setw(10) << "Speedup" << std::endl;
+    for (unsigned int threadCount : { 1u, 32u }) {
+        size_t perThread = std::max<size_t>(1, jobs / threadCount);
+        double heap = measure(*program, threadCount, perThread, false);
+        double pooled = measure(*program, threadCount, perThread, true);
+
+        std::cout << std::setw(8) << threadCount << std::setw(18) << std::fixed << std::setprecision(2) << heap / 1e6
+            << std::setw(18) << pooled / 1e6 << std::setw(9) << pooled / heap << "x" << std::endl;
+    }
+    return 0;
+}
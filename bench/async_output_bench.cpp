@@ -0,0 +1,139 @@
+#include "../src/AsyncOutput.hpp"
+#include "../src/Awabler.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+* @brief Prints every number from the input down to 1.
+*/
+static const char* countdown = "r3d; lbl 0; blw 0; eql; jmp 1; pop; dpl; pr1; blw 1; sbm 1; sub; jmp 0; lbl 1";
+
+/**
+* @brief Prints 30000 numbers, then computes for 30000 iterations without output, as many times as the input says.
+*/
+static const char* bursts =
+    "r3d; lbl 0; blw 0; eql; jmp 9; pop; "
+    "blw 100; blw 100; mul; blw 3; mul; lbl 1; blw 0; eql; jmp 2; pop; dpl; pr1; blw 1; sbm 1; sub; jmp 1; lbl 2; pop; pop; "
+    "blw 100; blw 100; mul; blw 3; mul; lbl 3; blw 0; eql; jmp 4; pop; blw 3; pop; blw 1; sbm 1; sub; jmp 3; lbl 4; pop; pop; "
+    "blw 1; sbm 1; sub; jmp 0; lbl 9";
+
+/**
+* @brief Output sink writing through stdio on the executing thread, like std::cout does.
+*/
+class FileOutput : public OutputSink {
+public:
+    explicit FileOutput(int fd) : file(fdopen(fd, "w")) {}
+    ~FileOutput() override { std::fclose(file); }
+
+    void write(std::string_view text) override { std::fwrite(text.data(), 1, text.size(), file); }
+
+private:
+    FILE* file;
+};
+
+struct Timing {
+    double executed = 0;                    // Until the executing thread is done
+    double written = 0;                     // Until everything is written
+};
+
+/**
+* @brief Runs the program into the sink on the file descriptor, and closes it.
+*/
+template <typename Sink>
+static Timing run(const CompiledProgram& program, const std::string& input, int fd) {
+    NullWarningSink warnings;
+    StringInput in(input);
+    VmState state;
+    Timing timing;
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        Sink output(fd);
+        AwaInterpreter::execute(program, state, { in, output, warnings });
+        timing.executed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if constexpr (std::is_same_v<Sink, AsyncOutput>) ::close(fd);
+    timing.written = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return timing;
+}
+
+/**
+* @brief Reads a pipe like a slow consumer, pausing after every read, and returns the bytes read.
+*/
+static size_t consume(int fd, std::chrono::microseconds pause) {
+    std::vector<char> buffer(16 << 10);
+    size_t total = 0;
+    ssize_t got;
+    while ((got = ::read(fd, buffer.data(), buffer.size())) > 0) {
+        total += static_cast<size_t>(got);
+        std::this_thread::sleep_for(pause);
+    }
+    ::close(fd);
+    return total;
+}
+
+/**
+* @brief Runs the program into a pipe read by a slow consumer.
+*/
+template <typename Sink>
+static Timing runPiped(const CompiledProgram& program, const std::string& input, std::chrono::microseconds pause, size_t& bytes) {
+    int fds[2];
+    if (pipe(fds) != 0) return {};
+
+    std::thread reader([&bytes, fd = fds[0], pause] { bytes = consume(fd, pause); });
+    Timing timing = run<Sink>(program, input, fds[1]);
+    reader.join();
+    return timing;
+}
+
+/**
+* @brief Compares writing the output of prn and pr1 through stdio on the executing thread and through AsyncOutput.
+* @details A steady countdown is written to a file, bursts of output between computations to a pipe whose reader
+*   pauses after every read of 16 KiB. Where stdio blocks the executing thread on the pipe, AsyncOutput lets it go on.
+*
+* Usage: async_output_bench [Numbers printed] [Bursts]
+*/
+int main(int argc, char* argv[]) {
+    std::string count = (argc > 1) ? argv[1] : "2000000";
+    std::string rounds = (argc > 2) ? argv[2] : "10";
+
+    Awabler::legacy = true;
+    std::shared_ptr<const CompiledProgram> steady = AwaInterpreter::compileAwably(countdown);
+    std::shared_ptr<const CompiledProgram> bursty = AwaInterpreter::compileAwably(bursts);
+
+    std::cout << "                  Executed ms           Written ms" << std::endl
+        << "Destination      stdio     Async        stdio     Async" << std::endl;
+    auto report = [](const std::string& name, const Timing& stdio, const Timing& async) {
+        std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(8) << stdio.executed * 1000 << std::setw(10) << async.executed * 1000
+            << std::setw(13) << stdio.written * 1000 << std::setw(10) << async.written * 1000 << std::endl;
+    };
+
+    char path[] = "/tmp/awa_async_output_XXXXXX";
+    int file = mkstemp(path);
+    Timing stdio = run<FileOutput>(*steady, count, dup(file));
+    off_t expected = lseek(file, 0, SEEK_END);
+    if (ftruncate(file, 0) != 0) return 1;
+    lseek(file, 0, SEEK_SET);
+    Timing async = run<AsyncOutput>(*steady, count, dup(file));
+    bool same = lseek(file, 0, SEEK_END) == expected;
+    ::close(file);
+    std::remove(path);
+    report("File", stdio, async);
+
+    for (auto pause : { std::chrono::microseconds(0), std::chrono::microseconds(1000), std::chrono::microseconds(3000) }) {
+        size_t stdioBytes = 0, asyncBytes = 0;
+        Timing stdio = runPiped<FileOutput>(*bursty, rounds, pause, stdioBytes);
+        Timing async = runPiped<AsyncOutput>(*bursty, rounds, pause, asyncBytes);
+        report("Pipe, " + std::to_string(pause.count()) + "us", stdio, async);
+        same &= stdioBytes == asyncBytes;
+    }
+
+    if (!same) {
+        std::cerr << "Error: The outputs differ in size." << std::endl;
+        return 1;
+    }
+    return 0;
+}
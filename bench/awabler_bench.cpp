@@ -0,0 +1,156 @@
+#include "../src/Awabler.hpp"
+#include "RandomAwably.hpp"
+#include <chrono>
+
+/**
+* @brief The string based Awabler the table driven one replaced, kept as the baseline.
+*/
+namespace reference {
+
+std::string convertAwatalk(int number, int length = 8) {
+    number = number & ((1 << length) - 1);
+    std::string binStr;
+    for (int i = length - 1; i >= 0; i--) {
+        if (number & (1 << i)) binStr += '1';
+        else binStr += '0';
+    }
+
+    replace(binStr, "01", "awawa ");
+    replace(binStr, "11", "wawa ");
+    replace(binStr, "0", "awa ");
+    replace(binStr, "1", "wa ");
+    replace(binStr, "wa wa", "wawa");
+    strip(binStr);
+
+    return binStr;
+}
+
+int convertAwatism(const std::string& instruction) {
+    static const std::vector<std::string> lookup = {
+        "nop", "prn", "pr1", "red", "r3d", "blw", "sbm", "pop", "dpl", "srn", "mrg",
+        "4dd", "sub", "mul", "div", "cnt", "lbl", "jmp", "eql", "lss", "gr8", "trm"
+    };
+
+    auto it = std::find(lookup.begin(), lookup.end(), instruction);
+    if (it == lookup.end()) return -1;
+
+    int index = static_cast<int>(std::distance(lookup.begin(), it));
+    return (index == 21) ? 31 : index;
+}
+
+int convertAwaSCII(std::string& byte) {
+    static const std::vector<std::string> lookup = {
+        "A", "W", "a", "w", "J", "E", "L", "Y", "H", "O",
+        "S", "I", "U", "M", "j", "e", "l", "y", "h", "o",
+        "s", "i", "u", "m", "P", "C", "N", "T", "p", "c",
+        "n", "t", "B", "D", "F", "G", "R", "b", "d", "f",
+        "g", "r", "0", "1", "2", "3", "4", "5", "6", "7",
+        "8", "9", "space", ".", ",", "!", "'", "(", ")", "~",
+        "_", "/", ";", "\\n"
+    };
+
+    auto it = std::find(lookup.begin(), lookup.end(), byte);
+    if (it == lookup.end()) return -1;
+    return static_cast<int>(std::distance(lookup.begin(), it));
+}
+
+std::string convertLine(const std::string& line) {
+    static const std::vector<std::string> s8 = {"blw"};
+    static const std::vector<std::string> u5 = {"sbm", "srn", "lbl", "jmp"};
+
+    std::string trimmed = line;
+    strip(trimmed);
+    if (trimmed.empty()) return "";
+
+    size_t pos = trimmed.find(' ');
+    if (pos == std::string::npos) {
+        if (std::find(s8.begin(), s8.end(), trimmed) != s8.end() ||
+            std::find(u5.begin(), u5.end(), trimmed) != u5.end()) {
+            return "";
+        }
+        return convertAwatalk(convertAwatism(trimmed), 5);
+    }
+
+    std::string instruction = trimmed.substr(0, pos);
+    std::string paramStr = trimmed.substr(pos + 1);
+    strip(paramStr);
+
+    if (std::find(s8.begin(), s8.end(), instruction) == s8.end() &&
+        std::find(u5.begin(), u5.end(), instruction) == u5.end()) {
+        return "";
+    }
+
+    int parameter;
+    if (paramStr.size() >= 3 && paramStr.substr(0, 2) == "S(" && paramStr.back() == ')') {
+        std::string inner = paramStr.substr(2, paramStr.size() - 3);
+        parameter = convertAwaSCII(inner);
+    }
+    else {
+        try {
+            parameter = std::stoi(paramStr);
+        }
+        catch (...) {
+            return "";
+        }
+    }
+
+    int paramLength = (std::find(u5.begin(), u5.end(), instruction) != u5.end()) ? 5 : 8;
+    return convertAwatalk(convertAwatism(instruction), 5) + " " + convertAwatalk(parameter, paramLength);
+}
+
+std::string convertCode(std::string code) {
+    replace(code, ";", "\n");
+
+    std::istringstream iss(code);
+    std::vector<std::string> parts = {"awa"};
+    std::string line;
+    while (std::getline(iss, line)) {
+        strip(line);
+        if (line.empty()) continue;
+
+        std::string converted = convertLine(line);
+        if (!converted.empty()) parts.push_back(converted);
+    }
+
+    return join(parts, " ");
+}
+
+}
+
+/**
+* @brief Compares the throughput of the table driven Awabler against the string based baseline.
+*
+* Usage: awabler_bench [Lines]
+*/
+int main(int argc, char* argv[]) {
+    size_t lines = (argc > 1) ? std::stoul(argv[1]) : 1000000;
+
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    RandomAwablyOptions options;
+    options.lines = lines;
+    options.perLine = 8;
+    options.strings = true;
+    std::string code = randomAwably(options);
+
+    auto start = std::chrono::steady_clock::now();
+    std::string before = reference::convertCode(code);
+    double beforeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::string after = Awabler::convertCode(code);
+    double afterSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Lines:   " << lines << " (" << code.size() / 1048576.0 << " MB Awably, " << after.size() / 1048576.0 << " MB Awalang)" << std::endl;
+    std::cout << "Before:  " << std::fixed << std::setprecision(0) << lines / beforeSeconds << " lines/s" << std::endl;
+    std::cout << "After:   " << lines / afterSeconds << " lines/s" << std::endl;
+    std::cout << "Speedup: " << std::setprecision(2) << beforeSeconds / afterSeconds << "x" << std::endl;
+
+    if (before != after) {
+        std::cerr << "Error: The outputs differ." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "../src/Awabler.hpp"
+#include "RandomAwably.hpp"
+#include <chrono>
+#include <thread>
+
+/**
+* @brief Warning sink keeping the line of every warning, to check the order across chunks.
+*/
+class LineLog : public WarningSink {
+public:
+    void warn(const Warning& warning) override { lines.push_back(warning.pc); }
+
+    std::vector<size_t> lines;
+};
+
+/**
+* @brief Measures the scaling of the chunked Awabler over thread counts, checking every output against one thread.
+*
+* Usage: awabler_parallel_bench [Megabytes] [MaxThreads]
+*/
+int main(int argc, char* argv[]) {
+    size_t megabytes = (argc > 1) ? std::stoul(argv[1]) : 64;
+    unsigned int maxThreads = (argc > 2) ? static_cast<unsigned int>(std::stoul(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+
+    Awabler::legacy = true;
+    RandomAwablyOptions options;
+    options.bytes = megabytes << 20;
+    options.perLine = 8;
+    options.invalidEvery = 4096;
+    std::string code = randomAwably(options);
+
+    std::string expected;
+    std::vector<size_t> expectedLines;
+    double baseSeconds = 0;
+
+    std::cout << "Input: " << code.size() / 1048576.0 << " MB Awably" << std::endl;
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        LineLog warnings;
+        Awabler::warnings = &warnings;
+
+        auto start = std::chrono::steady_clock::now();
+        std::string output = Awabler::convertCode(code, threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (threads == 1) {
+            expected = std::move(output);
+            expectedLines = std::move(warnings.lines);
+            baseSeconds = seconds;
+        }
+        else if (output != expected || warnings.lines != expectedLines) {
+            std::cerr << "Error: The output or the warnings differ on " << threads << " threads." << std::endl;
+            return 1;
+        }
+
+        std::cout << std::setw(3) << threads << " threads: " << std::fixed << std::setprecision(1)
+            << code.size() / 1048576.0 / seconds << " MB/s, speedup " << std::setprecision(2) << baseSeconds / seconds << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "../src/AwaInterpreter.hpp"
+#include "../src/Awabler.hpp"
+#include "../src/BatchRunner.hpp"
+#include <chrono>
+
+/**
+* @brief Measures BatchRunner throughput from 1 to 64 threads.
+* @details Every job reads a number and counts it down to 0, the same compiled program is shared by all jobs.
+*
+* Usage: batch_bench [Jobs]
+*/
+int main(int argc, char* argv[]) {
+    size_t jobCount = (argc > 1) ? std::stoul(argv[1]) : 20000;
+
+    Awabler::legacy = true;
+    std::string awably = "r3d; lbl 0; blw 0; eql; jmp 1; pop; blw 1; sbm 1; sub; jmp 0; lbl 1; pop; pr1;";
+    std::shared_ptr<const CompiledProgram> program = AwaInterpreter::compile(Awabler::convertCode(awably));
+
+    std::vector<BatchJob> jobs;
+    jobs.reserve(jobCount);
+    for (size_t i = 0; i < jobCount; i++) {
+        jobs.push_back({ program, std::to_string(100 + i % 400) });
+    }
+
+    std::cout << "Threads  Jobs/s         Speedup" << std::endl;
+    double baseline = 0;
+    for (unsigned int threads = 1; threads <= 64; threads *= 2) {
+        BatchRunner runner(threads);
+        size_t checksum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        runner.run(jobs, [&](BatchResult& result) { checksum += result.output.size(); });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double rate = jobCount / seconds;
+        if (threads == 1) baseline = rate;
+
+        std::cout << std::left << std::setw(9) << threads << std::setw(15) << std::fixed << std::setprecision(0) << rate
+            << std::setprecision(2) << rate / baseline << "x" << (checksum == 0 ? " (no output)" : "") << std::endl;
+    }
+
+    return 0;
+}
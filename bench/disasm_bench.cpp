@@ -0,0 +1,64 @@
+#include "../src/Disassembler.hpp"
+#include "../src/Awabler.hpp"
+#include "RandomAwably.hpp"
+#include <chrono>
+
+/**
+* @brief Disassembles Awalang in chunks of the given size.
+*/
+static std::string disassemble(const std::string& awalang, size_t chunkSize, bool characters) {
+    std::ostringstream oss;
+    Disassembler disassembler(oss, characters);
+    for (size_t offset = 0; offset < awalang.size(); offset += chunkSize) {
+        disassembler.feed(std::string_view(awalang).substr(offset, chunkSize));
+    }
+    disassembler.finish();
+    return oss.str();
+}
+
+/**
+* @brief Measures the streaming disassembler and checks that its output assembles back into the same Awalang.
+*
+* Usage: disasm_bench [Lines]
+*/
+int main(int argc, char* argv[]) {
+    size_t lines = (argc > 1) ? std::stoul(argv[1]) : 1000000;
+
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    RandomAwablyOptions options;
+    options.lines = lines;
+    std::string awalang = Awabler::convertCode(randomAwably(options));
+    std::cout << "Awalang: " << awalang.size() / 1048576.0 << " MB, " << lines << " instructions" << std::endl;
+
+    bool same = true;
+    for (bool characters : { false, true }) {
+        auto start = std::chrono::steady_clock::now();
+        std::string awably = disassemble(awalang, 1 << 20, characters);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << (characters ? "Characters: " : "Numbers:    ") << std::fixed << std::setprecision(1)
+            << awalang.size() / 1048576.0 / seconds << " MB/s Awalang, " << lines / seconds / 1e6 << " M instructions/s" << std::endl;
+
+        same &= Awabler::convertCode(awably) == awalang;
+    }
+
+    // Chunks cut through every token and the header
+    std::string small = awalang.substr(0, std::min<size_t>(awalang.size(), 100000));
+    std::string whole = disassemble(small, small.size(), false);
+    for (size_t chunkSize : { 1, 3, 7 }) {
+        same &= disassemble(small, chunkSize, false) == whole;
+    }
+
+    std::ostringstream fromData;
+    Disassembler::disassemble(*AwaInterpreter::compile(awalang), fromData);
+    same &= fromData.str() == disassemble(awalang, 1 << 20, false);
+
+    if (!same) {
+        std::cerr << "Error: The round trip failed." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "../src/AwaInterpreter.hpp"
+#include "../src/Awabler.hpp"
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <cstdlib>
+
+static std::atomic<uint64_t> allocations{ 0 };
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+/**
+* @brief Runs one loop body and reports the heap allocations per executed instruction.
+*/
+static void measure(const std::string& name, const std::string& body, int iterations) {
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    // [counter]: the body leaves the abyss as it found it, then count down
+    std::string code =
+        "blw " + std::to_string(iterations / 100) + "; blw 100; mul\n"
+        "lbl 0; blw 0; eql; jmp 1; pop\n" +
+        body + "\n"
+        "blw 1; sbm 1; sub; jmp 0\n"
+        "lbl 1\n";
+    std::shared_ptr<const CompiledProgram> program = AwaInterpreter::compileAwably(code);
+
+    StringInput input;
+    StringOutput output;
+    VmState state;
+    uint64_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    AwaInterpreter::execute(*program, state, { input, output, warnings });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocated = allocations.load() - before;
+
+    std::cout << std::setw(10) << name << std::setw(18) << std::fixed << std::setprecision(3) << static_cast<double>(allocated) / state.executionStep
+        << std::setw(18) << static_cast<double>(allocated) / iterations << std::setw(12) << std::setprecision(1) << seconds * 1e9 / state.executionStep << std::endl;
+}
+
+/**
+* @brief Counts the heap allocations of division heavy and short merge heavy programs.
+*
+* Usage: div_bench [Iterations]
+*/
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? std::stoi(argv[1]) : 10000;
+
+    std::cout << std::setw(10) << "Program" << std::setw(18) << "allocs/instr" << std::setw(18) << "allocs/iteration" << std::setw(12) << "ns/instr" << std::endl;
+    measure("div", "blw 50; blw 7; div; pop; 4dd; sbm 31", iterations);
+    measure("div-div", "blw 50; blw 7; div; blw 2; div; sbm 31", iterations);
+    measure("mrg", "blw 1; blw 2; mrg; blw 3; mrg; blw 4; mrg; sbm 31", iterations);
+    measure("srn", "blw 1; blw 2; blw 3; srn 3; dpl; mrg; sbm 31", iterations);
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "../src/AwaInterpreter.hpp"
+#include "../src/Awabler.hpp"
+#include <chrono>
+
+/**
+* @brief Duplicates a string read with red over and over, the time per dpl should not depend on the length of the string.
+*
+* Usage: dpl_bench [Iterations]
+*/
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? std::stoi(argv[1]) : 10000;
+
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    // [string, counter]: duplicate the string, count it, drop the copy by submerging it out of the abyss, then count down
+    std::string code =
+        "red; blw " + std::to_string(iterations / 100) + "; blw 100; mul\n"
+        "lbl 0; blw 0; eql; jmp 1; pop\n"
+        "sbm 1; dpl; cnt; sbm 31; sbm 31; sbm 1\n"
+        "blw 1; sbm 1; sub; jmp 0\n"
+        "lbl 1\n";
+    std::shared_ptr<const CompiledProgram> program = AwaInterpreter::compileAwably(code);
+
+    std::cout << std::setw(12) << "Characters" << std::setw(14) << "ns per dpl" << std::setw(16) << "Msteps/s" << std::endl;
+    for (size_t length = 16; length <= 1 << 16; length *= 16) {
+        std::string text;
+        while (text.size() < length) text += "awa awawa ";
+        text.resize(length);
+
+        StringInput input(text);
+        StringOutput output;
+        VmState state;
+        auto start = std::chrono::steady_clock::now();
+        AwaInterpreter::execute(*program, state, { input, output, warnings });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::setw(12) << length << std::setw(14) << std::fixed << std::setprecision(1) << seconds * 1e9 / iterations
+            << std::setw(16) << std::setprecision(2) << state.executionStep / seconds / 1e6 << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "../src/EmbeddedProgram.hpp"
+#include <chrono>
+#include <functional>
+
+static constexpr auto helloWorld = embedAwalang<"awa awa awawa awawa awa awawawa awawawa wa awa awawa awawa awa awawa awa awawawa awa awa awawa awawa awa awa awawa awa awa awa awa awa awawa awawa awa awawa awawa awa awawa awa awawa awawa awa awa awawa awa awawawa awa awawa awawa awa awa awa awa awa awawawa awa awawa awawa awa awawawa awawa awa awa awa awawa awawa awa awawawa awawawa awa awa awawa awawa awa awa awawa awa awawawa awa awawa awawa awa awa awawa awa awa awa awa awa awawa awawa awa awa awawa awa awa awa awa awa awawa awawa awa awa awa awawawa wawa awa awawa awawa awa awa awa awawa awa awa awa awawa awa awawa awawawa awawa awa awa awa awawa">();
+
+static constexpr auto countdown = embedAwably<"r3d; lbl 0; blw 0; eql; jmp 1; pop; blw 1; sbm 1; sub; jmp 0; lbl 1; pop; pr1", true>();
+
+// Decoded while compiling, not at startup
+static_assert(helloWorld.legacy && helloWorld.data.back() == prn);
+static_assert(countdown.legacy);
+static_assert(countdown.labels.size() == 2);
+static_assert(countdown.labelPosition(1) == 17);
+
+/**
+* @brief Checks an embedded program against the runtime front end and times both.
+*
+* @return false if the programs or their outputs differ.
+*/
+template <typename Embedded>
+static bool measure(const std::string& name, const Embedded& embedded, const std::function<std::shared_ptr<const CompiledProgram>()>& compile, const std::string& input, int repeats) {
+    std::shared_ptr<const CompiledProgram> runtime, direct;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        runtime = compile();
+    }
+    double runtimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        direct = embedded.toProgram();
+    }
+    double embeddedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    auto output = [&input](const CompiledProgram& program) {
+        NullWarningSink warnings;
+        StringInput in(input);
+        StringOutput out;
+        VmState state;
+        AwaInterpreter::execute(program, state, { in, out, warnings });
+        return out.output;
+    };
+
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << runtimeSeconds * 1e6 << " us" << std::setw(12) << embeddedSeconds * 1e6 << " us"
+        << std::setw(8) << std::setprecision(1) << runtimeSeconds / embeddedSeconds << "x" << std::endl;
+
+    return runtime->data == direct->data && runtime->lblTable == direct->lblTable && runtime->legacy == direct->legacy
+        && output(*runtime) == output(*direct);
+}
+
+/**
+* @brief Compares the startup time of programs decoded at runtime against programs embedded with EmbeddedProgram.hpp.
+*
+* Usage: embed_bench [Repeats]
+*/
+int main(int argc, char* argv[]) {
+    int repeats = (argc > 1) ? std::stoi(argv[1]) : 100000;
+
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    std::cout << std::left << std::setw(24) << "Program" << std::right << std::setw(15) << "Runtime" << std::setw(15) << "Embedded" << std::setw(9) << "Speedup" << std::endl;
+
+    bool same = true;
+    same &= measure("hello world (Awalang)", helloWorld, [] { return AwaInterpreter::compile("awa awa awawa awawa awa awawawa awawawa wa awa awawa awawa awa awawa awa awawawa awa awa awawa awawa awa awa awawa awa awa awa awa awa awawa awawa awa awawa awawa awa awawa awa awawa awawa awa awa awawa awa awawawa awa awawa awawa awa awa awa awa awa awawawa awa awawa awawa awa awawawa awawa awa awa awa awawa awawa awa awawawa awawawa awa awa awawa awawa awa awa awawa awa awawawa awa awawa awawa awa awa awawa awa awa awa awa awa awawa awawa awa awa awawa awa awa awa awa awa awawa awawa awa awa awa awawawa wawa awa awawa awawa awa awa awa awawa awa awa awa awawa awa awawa awawawa awawa awa awa awa awawa"); }, "", repeats);
+    same &= measure("countdown (Awably)", countdown, [] { return AwaInterpreter::compileAwably("r3d; lbl 0; blw 0; eql; jmp 1; pop; blw 1; sbm 1; sub; jmp 0; lbl 1; pop; pr1"); }, "25", repeats);
+
+    if (!same) {
+        std::cerr << "Error: The embedded programs differ." << std::endl;
+        return 1;
+    }
+    return 0;
+}
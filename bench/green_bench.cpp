@@ -0,0 +1,108 @@
+#include "../src/AwaInterpreter.hpp"
+#include "../src/Awabler.hpp"
+#include "../src/GreenScheduler.hpp"
+#include <chrono>
+#include <unistd.h>
+
+/**
+* @brief Reads the resident set size of the process from /proc.
+*/
+static size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static std::shared_ptr<const CompiledProgram> compileAwably(std::string awably) {
+    return AwaInterpreter::compile(Awabler::convertCode(awably));
+}
+
+/**
+* @brief Measures the memory of idle (parked) VMs and the cost of a context switch on one worker thread.
+*
+* Usage: green_bench [VMs]
+*/
+int main(int argc, char* argv[]) {
+    size_t vmCount = (argc > 1) ? std::stoul(argv[1]) : 10000;
+    Awabler::legacy = true;
+
+    std::cout << "Idle VMs:             " << vmCount << " (sizeof(GreenVm) = " << sizeof(GreenVm) << ")" << std::endl;
+
+    // The second program parks holding a double bubble, which takes the first chunk of its arena.
+    // Both schedulers are kept until the end, so the second one cannot reuse the memory of the first.
+    std::vector<std::unique_ptr<GreenScheduler>> idle;
+    for (const char* code : { "red; prn;", "blw 1; blw 2; mrg; red; prn; pr1;" }) {
+        auto echo = compileAwably(code);
+        idle.push_back(std::make_unique<GreenScheduler>(1));
+
+        size_t before = residentBytes();
+        for (size_t i = 0; i < vmCount; i++) {
+            idle.back()->spawn(echo);
+        }
+        idle.back()->wait();
+        size_t after = residentBytes();
+
+        std::cout << "Memory per idle VM:   " << (after - before) / vmCount << " bytes, " << code << std::endl;
+    }
+    for (std::unique_ptr<GreenScheduler>& scheduler : idle) {
+        for (size_t i = 0; i < vmCount; i++) {
+            scheduler->feed(i, "awa");
+        }
+        scheduler->wait();
+        const GreenVm* last = scheduler->finished(vmCount - 1);
+        std::cout << "Output of the last VM: " << (last ? last->output.output : "(not finished)") << std::endl;
+    }
+    idle.clear();
+
+    // The nop keeps the loop from being run natively as an idiom, so the unsliced baseline is interpreted like the slices
+    auto countdown = compileAwably("r3d; lbl 0; blw 0; eql; jmp 1; pop; nop; blw 1; sbm 1; sub; jmp 0; lbl 1; pop; pr1;");
+    if (!countdown->loops.empty()) {
+        std::cerr << "Error: The countdown is recognized as an idiom." << std::endl;
+        return 1;
+    }
+    size_t loopVms = std::min<size_t>(vmCount, 1000);
+
+    auto measure = [&](unsigned int slice, size_t& switches) {
+        GreenScheduler scheduler(1, slice);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < loopVms; i++) {
+            scheduler.spawn(countdown, "1000");
+        }
+        scheduler.wait();
+        switches = scheduler.switches();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    size_t baseSwitches;
+    double baseSeconds = measure(0, baseSwitches);
+
+    std::cout << std::endl << "Slice    Switches     Seconds    ns/switch" << std::endl;
+    std::cout << std::left << std::setw(9) << "none" << std::setw(13) << baseSwitches << std::setw(11) << std::fixed << std::setprecision(4) << baseSeconds << "-" << std::endl;
+    for (unsigned int slice : { 1024u, 256u, 64u, 16u, 4u, 1u }) {
+        size_t switches;
+        double seconds = measure(slice, switches);
+        double perSwitch = (seconds - baseSeconds) * 1e9 / static_cast<double>(switches - baseSwitches);
+        std::cout << std::setw(9) << slice << std::setw(13) << switches << std::setw(11) << std::setprecision(4) << seconds << std::setprecision(1) << perSwitch << std::endl;
+    }
+
+    // A short loop never reaches enough backward jumps within one slice to read the clock, its timeout has to hold anyway
+    {
+        GreenScheduler scheduler(1);
+        ExecutionLimits limits;
+        limits.timeout = std::chrono::milliseconds(100);
+        auto start = std::chrono::steady_clock::now();
+        GreenScheduler::VmId id = scheduler.spawn(compileAwably("lbl 0; nop; nop; nop; nop; nop; nop; jmp 0;"), "", limits);
+        scheduler.wait();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const GreenVm* vm = scheduler.finished(id);
+        std::cout << std::endl << "Sliced 100 ms timeout: " << std::setprecision(3) << seconds << " s" << std::endl;
+        if (!vm || vm->result != ExecuteStatus::Timeout || seconds > 1) {
+            std::cerr << "Error: The sliced VM did not time out." << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "../src/Lockstep.hpp"
+#include "../src/Awabler.hpp"
+#include <chrono>
+
+/**
+* @brief Reads x and maps it to -x - 21 a hundred times, the control flow is the same for every input.
+*/
+static const char* uniform =
+    "r3d; blw 100; lbl 0; blw 0; eql; jmp 1; pop; "
+    "sbm 1; dpl; blw 7; 4dd; blw 3; mul; sbm 1; blw 2; mul; sub; sbm 1; "
+    "blw 1; sbm 1; sub; jmp 0; lbl 1; pop; pop; pr1";
+
+/**
+* @brief Counts the input down to 0 with the same body, every input leaves the loop on another iteration.
+*/
+static const char* divergent =
+    "r3d; dpl; lbl 0; blw 0; eql; jmp 1; pop; "
+    "sbm 1; dpl; blw 7; 4dd; blw 3; mul; sbm 1; blw 2; mul; sub; sbm 1; "
+    "blw 1; sbm 1; sub; jmp 0; lbl 1; pop; pop; pr1";
+
+/**
+* @brief Runs the jobs and returns jobs per second, the outputs are concatenated in job order.
+*/
+template <typename Run>
+static double measure(Run run, std::string& outputs) {
+    outputs.clear();
+    auto start = std::chrono::steady_clock::now();
+    run([&outputs](BatchResult& result) { outputs += result.output; outputs += '\n'; });
+    return 1.0 / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+* @brief Compares the throughput of LockstepRunner with BatchRunner on one program over many inputs.
+*
+* Usage: lockstep_bench [Jobs]
+*/
+int main(int argc, char* argv[]) {
+    size_t jobCount = (argc > 1) ? std::stoul(argv[1]) : 20000;
+
+    Awabler::legacy = true;
+    for (const auto& [name, awably] : { std::pair{ "uniform", uniform }, std::pair{ "divergent", divergent } }) {
+        std::shared_ptr<const CompiledProgram> program = AwaInterpreter::compileAwably(awably);
+
+        std::vector<std::string> inputs;
+        std::vector<BatchJob> jobs;
+        for (size_t i = 0; i < jobCount; i++) {
+            inputs.push_back(std::to_string(50 + i % 100));
+            jobs.push_back({ program, inputs.back() });
+        }
+
+        std::cout << name << std::endl << "Runner                 Jobs/s     Speedup" << std::endl;
+        std::string expected, outputs;
+        double baseline = jobCount * measure([&](auto emit) { BatchRunner(1).run(jobs, emit); }, expected);
+        auto report = [&](const std::string& runner, double rate) {
+            std::cout << std::left << std::setw(19) << runner << std::right << std::setw(11) << std::fixed << std::setprecision(0) << rate
+                << std::setw(11) << std::setprecision(2) << rate / baseline << "x" << std::endl;
+        };
+        report("BatchRunner 1", baseline);
+
+        unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+        if (hardware > 1) {
+            report("BatchRunner " + std::to_string(hardware), jobCount * measure([&](auto emit) { BatchRunner(hardware).run(jobs, emit); }, outputs));
+            if (outputs != expected) std::cerr << "Error: The outputs of BatchRunner differ." << std::endl;
+        }
+
+        for (size_t width : { 8, 64, 256 }) {
+            LockstepStats stats;
+            report("Lockstep " + std::to_string(width), jobCount * measure([&](auto emit) { LockstepRunner({}, width).run(*program, inputs, emit, &stats); }, outputs));
+            if (outputs != expected) {
+                std::cerr << "Error: The outputs of LockstepRunner differ." << std::endl;
+                return 1;
+            }
+            if (width == 64) stats.print(std::cout);
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
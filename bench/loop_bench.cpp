@@ -0,0 +1,91 @@
+#include "../src/LoopIdioms.hpp"
+#include "../src/Awabler.hpp"
+#include <chrono>
+
+/**
+* @brief Reverses an abyss of N bubbles read from the input, then rotates it by one.
+* @details Fills the abyss with a countdown pushing its counter, reverses it by accumulating it into a double bubble
+*   with mrg and popping that, and rotates it through sbm, one loop of each idiom LoopIdioms recognizes.
+*/
+static const char* reversal =
+    "r3d\n"
+    "lbl 0\nblw 0\neql\njmp 1\npop\ndpl\nsbm 1\nblw 1\nsbm 1\nsub\njmp 0\n"
+    "lbl 1\npop\npop\n"
+    "srn 1\nr3d\nblw 1\nsbm 1\nsub\n"
+    "lbl 2\nblw 0\neql\njmp 3\npop\nsbm 2\nmrg\nsbm 1\nblw 1\nsbm 1\nsub\njmp 2\n"
+    "lbl 3\npop\npop\npop\n"
+    "blw 1\n"
+    "lbl 4\nblw 0\neql\njmp 5\npop\nsbm 1\nsbm 0\nblw 1\nsbm 1\nsub\njmp 4\n"
+    "lbl 5\npop\npop\n"
+    "pr1\nblw 32\nprn\npr1\nblw 32\nprn\npr1\n";
+
+struct Result {
+    std::shared_ptr<BubbleArena> arena;     // Holds the memory of the abyss
+    std::string output;
+    std::vector<Bubble> abyss;
+    uint64_t steps = 0;
+    double seconds = 0;
+};
+
+/**
+* @brief Runs a program once on the input and keeps everything its final state is compared by.
+*/
+static Result run(const CompiledProgram& program, const std::string& input) {
+    NullWarningSink warnings;
+    StringInput in(input);
+    StringOutput out;
+    VmState state;
+
+    auto start = std::chrono::steady_clock::now();
+    AwaInterpreter::execute(program, state, { in, out, warnings });
+    Result result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.output = out.output;
+    result.arena = state.arena;
+    result.abyss = std::move(state.bubbleAbyss);
+    result.steps = state.executionStep;
+    return result;
+}
+
+static bool sameBubbles(const Bubble& a, const Bubble& b) {
+    if (isDouble(a) != isDouble(b)) return false;
+    if (!isDouble(a)) return getInt(a) == getInt(b);
+    const BubbleVector& listA = getList(a);
+    const BubbleVector& listB = getList(b);
+    return std::equal(listA.begin(), listA.end(), listB.begin(), listB.end(), sameBubbles);
+}
+
+/**
+* @brief Compares the reversal of large abysses with the loops interpreted and run as recognized idioms.
+*
+* Usage: loop_bench [Sizes...]
+*/
+int main(int argc, char* argv[]) {
+    std::vector<std::string> sizes = { "1000", "10000", "100000", "1000000" };
+    if (argc > 1) sizes.assign(argv + 1, argv + argc);
+
+    Awabler::legacy = true;
+    std::shared_ptr<const CompiledProgram> program = AwaInterpreter::compileAwably(reversal);
+    CompiledProgram interpreted = *program;
+    interpreted.loops.clear();
+    std::cout << "Recognized " << program->loops.size() << " of 3 loops" << std::endl;
+
+    std::cout << std::left << std::setw(10) << "Bubbles" << std::right << std::setw(12) << "Steps"
+        << std::setw(14) << "Interpreted" << std::setw(12) << "Idioms" << std::setw(10) << "Speedup" << std::endl;
+    for (const std::string& size : sizes) {
+        Result before = run(interpreted, size);
+        Result after = run(*program, size);
+
+        std::cout << std::fixed << std::left << std::setw(10) << size << std::right << std::setw(12) << before.steps
+            << std::setprecision(4) << std::setw(12) << before.seconds << " s" << std::setw(10) << after.seconds << " s"
+            << std::setprecision(1) << std::setw(9) << before.seconds / after.seconds << "x" << std::endl;
+
+        bool same = before.output == after.output && before.steps == after.steps
+            && std::equal(before.abyss.begin(), before.abyss.end(), after.abyss.begin(), after.abyss.end(), sameBubbles);
+        if (!same) {
+            std::cerr << "Error: The final states differ at " << size << " bubbles." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
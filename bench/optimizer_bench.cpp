@@ -0,0 +1,77 @@
+#include "../src/Optimizer.hpp"
+#include <chrono>
+
+/**
+* @brief Builds an AWA5.0++ countdown loop keeping its constants in registers.
+* @details The Awabler emits no flag bits for AWA5.0++, so the program is assembled straight into its decoded form.
+*/
+static std::shared_ptr<const CompiledProgram> countdown() {
+    auto program = std::make_shared<CompiledProgram>();
+    program->data = {
+        mov, 0, 1, 1,           // r1 = 1, the loop label
+        mov, 0, 2, 1,           // r2 = 1, the decrement
+        mov, 0, 3, 0,           // r3 = 0, the end
+        r3d,
+        lbl, 1,
+        blw, 1, 3,
+        eql,
+        jmp, 0, 0,              // A false condition skips two slots into the 0, which runs as nop
+        pop, 4,
+        blw, 1, 2,
+        sbm, 1, 2,
+        sub,
+        mov, 0, 5, 7,           // Never read
+        jmp, 1, 1,
+        lbl, 0,
+        pop, 4,
+        pr1
+    };
+    forEachLabel(program->data, 0, [&program](int label, size_t position) { program->lblTable[label] = position; });
+    return program;
+}
+
+/**
+* @brief Runs a program once on the input and returns its output, steps and seconds.
+*/
+static std::string run(const CompiledProgram& program, const std::string& input, uint64_t& steps, double& seconds) {
+    NullWarningSink warnings;
+    StringInput in(input);
+    StringOutput out;
+    VmState state;
+
+    auto start = std::chrono::steady_clock::now();
+    AwaInterpreter::execute(program, state, { in, out, warnings });
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    steps = state.executionStep;
+    return out.output;
+}
+
+/**
+* @brief Compares a register heavy AWA5.0++ loop before and after Optimizer::optimize.
+*
+* Usage: optimizer_bench [Iterations]
+*/
+int main(int argc, char* argv[]) {
+    std::string iterations = (argc > 1) ? argv[1] : "2000000";
+
+    std::shared_ptr<const CompiledProgram> program = countdown();
+    OptimizationReport report;
+    std::shared_ptr<const CompiledProgram> optimized = Optimizer::optimize(program, report);
+    report.print(std::cout);
+
+    uint64_t beforeSteps, afterSteps;
+    double beforeSeconds, afterSeconds;
+    std::string before = run(*program, iterations, beforeSteps, beforeSeconds);
+    std::string after = run(*optimized, iterations, afterSteps, afterSeconds);
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "Before:  " << beforeSteps << " steps in " << beforeSeconds << " s" << std::endl
+        << "After:   " << afterSteps << " steps in " << afterSeconds << " s" << std::endl
+        << "Speedup: " << std::setprecision(2) << beforeSeconds / afterSeconds << "x" << std::endl;
+
+    if (before != after) {
+        std::cerr << "Error: The outputs differ." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "../src/Pipeline.hpp"
+#include "../src/Awabler.hpp"
+#include <chrono>
+
+/**
+* @brief Output sink remembering when it was first written to.
+*/
+class TimedOutput : public OutputSink {
+public:
+    explicit TimedOutput(std::chrono::steady_clock::time_point start) : start(start) {}
+
+    void write(std::string_view text) override {
+        if (output.empty()) first = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        output.append(text);
+    }
+
+    std::chrono::steady_clock::time_point start;
+    double first = 0;
+    std::string output;
+};
+
+struct Timing {
+    double first = 0;
+    double total = 0;
+    std::string output;
+};
+
+/**
+* @brief Runs the Awalang once, either decoded completely first or through the Pipeline.
+*/
+static Timing run(const std::string& awalang, bool pipelined) {
+    NullWarningSink warnings;
+    StringInput in;
+    VmState state;
+
+    auto start = std::chrono::steady_clock::now();
+    TimedOutput out(start);
+    if (pipelined) {
+        Pipeline::run(awalang, state, { in, out, warnings });
+    }
+    else {
+        AwaInterpreter::execute(*AwaInterpreter::compile(awalang), state, { in, out, warnings });
+    }
+    return { out.first, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), std::move(out.output) };
+}
+
+/**
+* @brief Compares the time to the first output and to the end of a long straight program, decoded before or while it runs.
+* @details The legacy program prints characters and pops numbers, without jumps, so the Pipeline can run it as it is decoded.
+*
+* Usage: pipeline_bench [Lines of Awably]
+*/
+int main(int argc, char* argv[]) {
+    size_t lines = (argc > 1) ? std::stoul(argv[1]) : 400000;
+
+    Awabler::legacy = true;
+    std::string awably;
+    for (size_t i = 0; i < lines / 4; i++) {
+        awably += "blw " + std::to_string(i % 52) + "\nprn\nblw " + std::to_string(i % 31) + "\npop\n";
+    }
+    std::string awalang = Awabler::convertCode(awably);
+
+    std::cout << awalang.size() / 1024 << " KiB of Awalang" << std::endl << "Mode          First output    Total" << std::endl;
+    Timing complete = run(awalang, false);
+    Timing pipelined = run(awalang, true);
+    for (const auto& [name, timing] : { std::pair{ "Compile", &complete }, std::pair{ "Pipeline", &pipelined } }) {
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(11) << timing->first * 1000 << " ms" << std::setw(9) << timing->total * 1000 << " ms" << std::endl;
+    }
+    if (pipelined.output != complete.output) {
+        std::cerr << "Error: The outputs differ." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#include "../src/Repl.hpp"
+#include "../src/Awabler.hpp"
+#include <chrono>
+#include <sstream>
+
+/**
+* @brief Measures the latency of REPL lines as the session grows, it should not depend on the size of the program.
+*
+* Usage: repl_bench [Lines]
+*/
+int main(int argc, char* argv[]) {
+    size_t lines = (argc > 1) ? std::stoul(argv[1]) : 100000;
+
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    // Every line defines a label and jumps past the next one, like an exploratory session building up a program
+    Repl repl("", {}, warnings);
+    std::ostringstream out;
+    size_t done = 0;
+    std::cout << std::setw(10) << "Lines" << std::setw(16) << "us per line" << std::endl;
+    for (size_t batch = 1000; done < lines; batch *= 10) {
+        std::string session;
+        for (size_t i = 0; i < batch; i++) {
+            session += "blw " + std::to_string(i % 100) + "; lbl " + std::to_string(i % 32) + "; pop\n";
+        }
+
+        std::istringstream in(session);
+        auto start = std::chrono::steady_clock::now();
+        repl.run(in, out, false);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done += batch;
+
+        std::cout << std::setw(10) << done << std::setw(16) << std::fixed << std::setprecision(2) << seconds * 1e6 / batch << std::endl;
+    }
+    return 0;
+}
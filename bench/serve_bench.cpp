@@ -0,0 +1,157 @@
+#include "../src/Server.hpp"
+#include "../src/Awabler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+/**
+* @brief Reads a number and prints its countdown, a program running for microseconds like most requests.
+*/
+static const char* countdown = "r3d; lbl 0; blw 0; eql; jmp 1; pop; dpl; pr1; blw 1; sbm 1; sub; jmp 0; lbl 1";
+
+static std::atomic<bool> failed{ false };
+
+struct Latencies {
+    double seconds = 0;
+    std::vector<double> requests;
+
+    void report(const std::string& name) {
+        std::sort(requests.begin(), requests.end());
+        auto percentile = [this](double p) { return requests[std::min(requests.size() - 1, static_cast<size_t>(p * requests.size()))] * 1e6; };
+        std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0)
+            << std::setw(10) << requests.size() / seconds << std::setprecision(1)
+            << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.99) << std::endl;
+    }
+};
+
+/**
+* @brief Sends the requests over one connection per client thread and times every request.
+*/
+static Latencies measure(const std::string& socket, unsigned int clients, size_t requests, bool byId, const std::vector<std::string>& expected) {
+    Latencies latencies;
+    std::vector<std::vector<double>> perClient(clients);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c] {
+            ServeClient client;
+            if (!client.connect(socket)) {
+                failed = true;
+                return;
+            }
+
+            ServeRequest request;
+            request.code = countdown;
+            request.isAwalang = false;
+            request.legacy = true;
+            ServeResponse response;
+            for (size_t r = c; r < requests; r += clients) {
+                request.input = std::to_string(r % 20);
+                auto sent = std::chrono::steady_clock::now();
+                if (!client.run(request, response) || response.result != ServeResponse::Result::Ran) {
+                    std::cerr << "Error: A request failed." << std::endl;
+                    failed = true;
+                    return;
+                }
+                if (response.output != expected[r % 20]) {
+                    std::cerr << "Error: The output of the server differs." << std::endl;
+                    failed = true;
+                    return;
+                }
+                perClient[c].push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - sent).count());
+
+                if (byId) {
+                    request.programId = response.programId;
+                    request.code.clear();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    latencies.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (std::vector<double>& times : perClient) {
+        latencies.requests.insert(latencies.requests.end(), times.begin(), times.end());
+    }
+    return latencies;
+}
+
+/**
+* @brief Starts the awa binary once per request, as running the program without a server does.
+*/
+static Latencies measureProcesses(const std::string& binary, size_t requests) {
+    Latencies latencies;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < requests; r++) {
+        std::string input = std::to_string(r % 20);
+        std::vector<char*> argv = { const_cast<char*>(binary.c_str()), const_cast<char*>("-Ab"), const_cast<char*>("-L"),
+            const_cast<char*>("-I"), input.data(), const_cast<char*>(countdown), nullptr };
+
+        auto sent = std::chrono::steady_clock::now();
+        pid_t pid;
+        int status = 0;
+        if (posix_spawn(&pid, binary.c_str(), &actions, nullptr, argv.data(), environ) != 0 || waitpid(pid, &status, 0) < 0) {
+            std::cerr << "Error: Unable to run " << binary << "." << std::endl;
+            break;
+        }
+        latencies.requests.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - sent).count());
+    }
+    latencies.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    posix_spawn_file_actions_destroy(&actions);
+    return latencies;
+}
+
+/**
+* @brief Measures requests per second and latency of a Server on a local socket, against starting awa for every run.
+*
+* Usage: serve_bench [Requests] [awa binary]
+*/
+int main(int argc, char* argv[]) {
+    size_t requests = (argc > 1) ? std::stoul(argv[1]) : 50000;
+    std::string binary = (argc > 2) ? argv[2] : "./awa";
+
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+    std::string socket = "/tmp/awa_serve_bench_" + std::to_string(getpid()) + ".sock";
+    Server server(socket, [](const std::string& code, std::optional<bool>, bool legacy, WarningSink& warnings) { return AwaInterpreter::compileAwably(code, legacy, warnings); });
+    if (!server.listen()) return 1;
+
+    std::atomic<bool> stop{ false };
+    std::thread serving([&] { server.run(stop); });
+
+    std::shared_ptr<const CompiledProgram> program = AwaInterpreter::compileAwably(countdown);
+    std::vector<std::string> expected;
+    for (int n = 0; n < 20; n++) {
+        StringInput in(std::to_string(n));
+        StringOutput out;
+        VmState state;
+        AwaInterpreter::execute(*program, state, { in, out, warnings });
+        expected.push_back(out.output);
+    }
+
+    std::cout << "Mode                     Req/s   p50 us    p99 us" << std::endl;
+    measure(socket, server.threads(), requests / 10, true, expected);
+    measure(socket, server.threads(), requests, false, expected).report("Server, code");
+    measure(socket, server.threads(), requests, true, expected).report("Server, program id");
+
+    stop = true;
+    serving.join();
+
+    if (access(binary.c_str(), X_OK) == 0) {
+        measureProcesses(binary, std::max<size_t>(1, requests / 100)).report("Process per run");
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+#include "../src/AwaInterpreter.hpp"
+#include "../src/Awabler.hpp"
+#include "RandomAwably.hpp"
+#include <chrono>
+#include <fstream>
+
+/**
+* @brief Times both front ends on one program and checks that they compile the same program.
+*
+* @return false if the programs differ.
+*/
+static bool measure(const std::string& name, const std::string& code, int repeats) {
+    std::shared_ptr<const CompiledProgram> viaText, direct;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        viaText = AwaInterpreter::compile(Awabler::convertCode(code));
+    }
+    double textSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        direct = AwaInterpreter::compileAwably(code);
+    }
+    double directSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << textSeconds * 1e6 << " us" << std::setw(12) << directSeconds * 1e6 << " us"
+        << std::setw(8) << std::setprecision(2) << textSeconds / directSeconds << "x" << std::endl;
+
+    return viaText->data == direct->data && viaText->lblTable == direct->lblTable;
+}
+
+/**
+* @brief Compares the startup time of Awably programs compiled through the Awalang text against the direct path.
+*
+* Usage: startup_bench [Awably files...]
+*/
+int main(int argc, char* argv[]) {
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+
+    std::cout << std::left << std::setw(36) << "Program" << std::right << std::setw(15) << "Via Awalang" << std::setw(15) << "Direct" << std::setw(9) << "Speedup" << std::endl;
+
+    bool same = true;
+    for (bool legacy : { true, false }) {
+        Awabler::legacy = legacy;
+        const std::string mode = legacy ? " (legacy)" : " (AWA5.0++)";
+
+        for (int i = 1; i < argc; i++) {
+            std::ifstream file(argv[i], std::ios::in | std::ios::binary);
+            std::string code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            same &= measure(argv[i] + mode, code, 1000);
+        }
+
+        for (size_t lines : { 100, 10000, 1000000 }) {
+            RandomAwablyOptions options;
+            options.lines = lines;
+            same &= measure(std::to_string(lines) + " lines" + mode, randomAwably(options), static_cast<int>(std::max<size_t>(1, 100000 / lines)));
+        }
+    }
+
+    if (!same) {
+        std::cerr << "Error: The compiled programs differ." << std::endl;
+        return 1;
+    }
+    return 0;
+}
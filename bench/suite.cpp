@@ -0,0 +1,426 @@
+#include "../src/AwaInterpreter.hpp"
+#include "../src/Awabler.hpp"
+#include "RandomAwably.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> allocations{ 0 };
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+/**
+* @brief Output sink counting the bytes and dropping them.
+*/
+class CountingOutput : public OutputSink {
+public:
+    void write(std::string_view text) override { bytes += text.size(); }
+
+    uint64_t bytes = 0;
+};
+
+/**
+* @brief Emits legacy Awably pushing a number of up to 999999, blw alone only reaches 127.
+*/
+static std::string pushNumber(size_t n) {
+    std::string code = "blw " + std::to_string(n / 10000 % 100);
+    for (size_t divisor : { 100, 1 }) {
+        code += "; blw 100; mul; blw " + std::to_string(n / divisor % 100) + "; 4dd";
+    }
+    return code + "\n";
+}
+
+/**
+* @brief Wraps a loop body in a countdown, the body starts and must end with the counter on top.
+*/
+static std::string loop(size_t iterations, const std::string& body, const std::string& setup = "") {
+    return setup + pushNumber(iterations) +
+        "lbl 0; blw 0; eql; jmp 1; pop\n" +
+        body + "\n"
+        "blw 1; sbm 1; sub; jmp 0\n"
+        "lbl 1\n";
+}
+
+/**
+* @brief Generates random legacy Awably without labels or jumps, for the decode workloads.
+*/
+static std::string decodeSource(size_t bytes) {
+    RandomAwablyOptions options;
+    options.bytes = bytes;
+    options.jumps = false;
+    options.terminate = false;
+    return randomAwably(options);
+}
+
+struct Workload {
+    enum class Kind {
+        Execute,            // Runs the generated Awably
+        DecodeAwalang,      // Compiles the generated Awalang
+        Awabler             // Converts the generated Awably into Awalang
+    };
+
+    std::string name;
+    Kind kind;
+    size_t size;            // Loop iterations, or bytes of source
+    std::string input;
+    std::function<std::string(size_t)> generate;
+};
+
+static const std::vector<Workload>& workloads() {
+    static const std::vector<Workload> all = {
+        { "arithmetic", Workload::Kind::Execute, 20000, "",
+            [](size_t n) { return loop(n, "blw 7; blw 5; 4dd; blw 3; mul; blw 2; sub; blw 4; div; pop; 4dd; sbm 31"); } },
+        { "rotation", Workload::Kind::Execute, 20000, "",
+            [](size_t n) { return loop(n, "sbm 1; sbm 8; sbm 1; sbm 8; sbm 1; sbm 8; sbm 1; sbm 8", "blw 1; blw 2; blw 3; blw 4; blw 5; blw 6; blw 7; blw 8\n"); } },
+        { "strings", Workload::Kind::Execute, 20000, "awa awawa awa wawa awa awa awawa awa wawa awa awa awawa awa wawa awa",
+            [](size_t n) { return loop(n, "red; prn; red; dpl; mrg; prn"); } },
+        { "groups", Workload::Kind::Execute, 20000, "",
+            [](size_t n) { return loop(n, "blw 1; blw 2; blw 3; blw 4; srn 4; blw 5; blw 6; mrg; mrg; dpl; mrg; cnt; sbm 31; sbm 31"); } },
+        { "decode", Workload::Kind::DecodeAwalang, 4 << 20, "",
+            [](size_t n) { return Awabler::convertCode(decodeSource(n / 6)); } },
+        { "awabler", Workload::Kind::Awabler, 4 << 20, "",
+            [](size_t n) { return decodeSource(n); } },
+    };
+    return all;
+}
+
+struct Measurement {
+    uint64_t steps = 0;
+    uint64_t bytes = 0;
+    double seconds = 0;
+    uint64_t allocations = 0;
+    long peakRssKb = 0;
+};
+
+/**
+* @brief Runs a workload, the time is the best of the repeats, the allocations are those of the first one.
+*/
+static Measurement measure(const Workload& workload, size_t size, int repeats) {
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+    Awabler::verbose = false;
+
+    const std::string source = workload.generate(size);
+    std::shared_ptr<const CompiledProgram> program;
+    if (workload.kind == Workload::Kind::Execute) {
+        program = AwaInterpreter::compileAwably(source);
+    }
+
+    Measurement result;
+    result.seconds = 1e300;
+    for (int r = 0; r < repeats; r++) {
+        uint64_t allocationsBefore = allocations.load();
+        auto start = std::chrono::steady_clock::now();
+
+        switch (workload.kind) {
+        case Workload::Kind::Execute: {
+            StringInput input(workload.input);
+            CountingOutput output;
+            VmState state;
+            AwaInterpreter::execute(*program, state, { input, output, warnings });
+            result.steps = state.executionStep;
+            result.bytes = output.bytes;
+            break;
+        }
+        case Workload::Kind::DecodeAwalang:
+            result.steps = AwaInterpreter::compile(source)->data.size();
+            result.bytes = source.size();
+            break;
+        case Workload::Kind::Awabler:
+            result.steps = Awabler::convertCode(source).size();
+            result.bytes = source.size();
+            break;
+        }
+
+        result.seconds = std::min(result.seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        if (r == 0) result.allocations = allocations.load() - allocationsBefore;
+    }
+
+    if (workload.kind != Workload::Kind::Execute) {
+        result.steps = 0;
+    }
+
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    result.peakRssKb = usage.ru_maxrss;
+#endif
+    return result;
+}
+
+/**
+* @brief Formats one workload as one line of JSON, the keys are always written in the same order.
+*/
+static std::string toJson(const Workload& workload, size_t size, const Measurement& m) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3)
+        << "{\"name\": \"" << workload.name << "\", \"size\": " << size
+        << ", \"steps\": " << m.steps << ", \"bytes\": " << m.bytes << ", \"seconds\": " << std::setprecision(6) << m.seconds
+        << ", \"steps_per_sec\": " << std::setprecision(0) << m.steps / m.seconds
+        << ", \"mb_per_sec\": " << std::setprecision(3) << m.bytes / m.seconds / 1e6
+        << ", \"allocations\": " << m.allocations << ", \"peak_rss_kb\": " << m.peakRssKb << "}";
+    return oss.str();
+}
+
+/**
+* @brief Measures a workload in a child process of its own, so its peak RSS is not raised by the workloads before it.
+*/
+static std::string isolated(const Workload& workload, size_t size, int repeats) {
+#ifndef _WIN32
+    int fds[2];
+    if (pipe(fds) == 0) {
+        std::cout << std::flush;
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            std::string line = toJson(workload, size, measure(workload, size, repeats));
+            ssize_t written = write(fds[1], line.data(), line.size());
+            _exit(written == static_cast<ssize_t>(line.size()) ? 0 : 1);
+        }
+
+        close(fds[1]);
+        std::string line;
+        char buffer[4096];
+        for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+            line.append(buffer, n);
+        }
+        close(fds[0]);
+
+        int status = 0;
+        if (pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            return line;
+        }
+        std::cerr << "[Bench] Error: Workload " << workload.name << " failed." << std::endl;
+        return "";
+    }
+#endif
+    return toJson(workload, size, measure(workload, size, repeats));
+}
+
+/**
+* @brief Reads the numeric fields of the workloads in a result file, by workload name.
+*/
+static std::map<std::string, std::map<std::string, double>> readResults(const std::string& path) {
+    std::map<std::string, std::map<std::string, double>> results;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t name = line.find("\"name\": \"");
+        if (name == std::string::npos) continue;
+
+        name += 9;
+        std::map<std::string, double>& fields = results[line.substr(name, line.find('"', name) - name)];
+        for (size_t key = line.find(", \""); key != std::string::npos; key = line.find(", \"", key + 1)) {
+            size_t keyEnd = line.find('"', key + 3);
+            fields[line.substr(key + 3, keyEnd - key - 3)] = std::strtod(line.c_str() + keyEnd + 3, nullptr);
+        }
+    }
+    return results;
+}
+
+/**
+* @brief Runs a binary on a source file and waits for it, its output is dropped.
+*
+* @return The wall time in seconds, negative if it could not be run.
+*/
+static double runBinary(const std::string& binary, const std::vector<std::string>& arguments) {
+#ifndef _WIN32
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(binary.c_str()));
+    for (const std::string& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (FILE* null = std::fopen("/dev/null", "w")) {
+            dup2(fileno(null), STDOUT_FILENO);
+            dup2(fileno(null), STDERR_FILENO);
+        }
+        execv(binary.c_str(), argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        return -1;
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#else
+    return -1;
+#endif
+}
+
+/**
+* @brief Times whole interpreter binaries on every workload, the best of the repeats, relative to the first binary.
+* @details Also serves as the training run of the profile guided build.
+*/
+static int compareBinaries(const std::vector<std::string>& binaries, double scale, int repeats, const std::string& only) {
+    NullWarningSink warnings;
+    Awabler::warnings = &warnings;
+    Awabler::legacy = true;
+
+    std::cout << std::left << std::setw(14) << "Workload";
+    for (const std::string& binary : binaries) {
+        std::cout << std::right << std::setw(std::max<int>(14, static_cast<int>(binary.size()) + 2)) << binary;
+    }
+    std::cout << std::setw(10) << "Speedup" << std::endl;
+
+    for (const Workload& workload : workloads()) {
+        if (!only.empty() && workload.name != only) continue;
+
+        const std::string path = "build/bench/" + workload.name + ".awa";
+        {
+            std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            file << workload.generate(std::max<size_t>(1, static_cast<size_t>(workload.size * scale)));
+        }
+
+        std::vector<std::string> arguments;
+        switch (workload.kind) {
+        case Workload::Kind::Execute:
+            arguments = { "-L", "-Ab", "--file", path, "-I", workload.input };
+            break;
+        case Workload::Kind::DecodeAwalang:
+            // Disassembling decodes without executing the random program
+            arguments = { "-X", "--file", path };
+            break;
+        case Workload::Kind::Awabler:
+            arguments = { "-L", "-Ab", "-E", "--file", path };
+            break;
+        }
+
+        std::cout << std::left << std::setw(14) << workload.name << std::right << std::fixed << std::setprecision(3);
+        std::vector<double> best(binaries.size(), 1e300);
+        for (int r = 0; r < repeats; r++) {
+            for (size_t b = 0; b < binaries.size(); b++) {
+                double seconds = runBinary(binaries[b], arguments);
+                if (seconds < 0) {
+                    std::cerr << "[Bench] Error: Could not run " << binaries[b] << "." << std::endl;
+                    return 1;
+                }
+                best[b] = std::min(best[b], seconds);
+            }
+        }
+
+        for (size_t b = 0; b < binaries.size(); b++) {
+            std::cout << std::setw(std::max<int>(14, static_cast<int>(binaries[b].size()) + 2) - 2) << best[b] << " s";
+        }
+        std::cout << std::setw(9) << std::setprecision(2) << best.front() / best.back() << "x" << std::endl;
+        std::remove(path.c_str());
+    }
+    return 0;
+}
+
+static int compare(const std::string& before, const std::string& after) {
+    auto oldResults = readResults(before);
+    auto newResults = readResults(after);
+    if (oldResults.empty() || newResults.empty()) {
+        std::cerr << "[Bench] Error: No results in " << (oldResults.empty() ? before : after) << "." << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(14) << "Workload" << std::right << std::setw(16) << "steps/s" << std::setw(12) << "MB/s"
+        << std::setw(14) << "allocations" << std::setw(14) << "peak RSS" << std::endl;
+    for (const auto& [name, fields] : newResults) {
+        auto old = oldResults.find(name);
+        if (old == oldResults.end()) continue;
+
+        std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(2);
+        for (const char* key : { "steps_per_sec", "mb_per_sec", "allocations", "peak_rss_kb" }) {
+            double a = old->second.count(key) ? old->second.at(key) : 0, b = fields.count(key) ? fields.at(key) : 0;
+            std::ostringstream ratio;
+            if (a > 0) ratio << std::fixed << std::setprecision(2) << b / a << "x";
+            else ratio << "-";
+            std::cout << std::setw(std::string(key) == "steps_per_sec" ? 16 : (std::string(key) == "mb_per_sec" ? 12 : 14)) << ratio.str();
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+/**
+* @brief Benchmark suite over generated workloads, the results are JSON with one workload per line.
+*
+* Usage: suite [--label <Text>] [--scale <Factor>] [--only <Workload>]
+*        suite --generate <Workload> [Size]     Print the source of a workload
+*        suite --compare <Before.json> <After.json>
+*        suite --binaries <awa> [awa-fast...]     Time whole interpreter binaries on the workloads
+*/
+int main(int argc, char* argv[]) {
+    std::string label, only;
+    std::vector<std::string> binaries;
+    double scale = 1;
+    int repeats = 3;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--compare" && i + 2 < argc) {
+            return compare(argv[i + 1], argv[i + 2]);
+        }
+        else if (arg == "--generate" && i + 1 < argc) {
+            for (const Workload& workload : workloads()) {
+                if (workload.name == argv[i + 1]) {
+                    NullWarningSink warnings;
+                    Awabler::warnings = &warnings;
+                    Awabler::legacy = true;
+                    std::cout << workload.generate((i + 2 < argc) ? std::stoul(argv[i + 2]) : workload.size);
+                    return 0;
+                }
+            }
+            std::cerr << "[Bench] Error: Unknown workload " << argv[i + 1] << "." << std::endl;
+            return 1;
+        }
+        else if (arg == "--binaries" && i + 1 < argc) {
+            while (i + 1 < argc && !std::string(argv[i + 1]).starts_with("--")) binaries.push_back(argv[++i]);
+        }
+        else if (arg == "--label" && i + 1 < argc) label = argv[++i];
+        else if (arg == "--scale" && i + 1 < argc) scale = std::stod(argv[++i]);
+        else if (arg == "--only" && i + 1 < argc) only = argv[++i];
+        else if (arg == "--repeats" && i + 1 < argc) repeats = std::max(1, std::stoi(argv[++i]));
+        else {
+            std::cerr << "Usage: suite [--label <Text>] [--scale <Factor>] [--repeats <Count>] [--only <Workload>]" << std::endl;
+            std::cerr << "       suite --generate <Workload> [Size]" << std::endl;
+            std::cerr << "       suite --compare <Before.json> <After.json>" << std::endl;
+            std::cerr << "       suite --binaries <awa> [awa-fast...] [--scale <Factor>] [--repeats <Count>] [--only <Workload>]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!binaries.empty()) {
+        return compareBinaries(binaries, scale, repeats, only);
+    }
+
+    std::cout << "{\"format\": 1, \"label\": \"" << label << "\", \"workloads\": [" << std::endl;
+    bool first = true;
+    for (const Workload& workload : workloads()) {
+        if (!only.empty() && workload.name != only) continue;
+
+        std::string line = isolated(workload, std::max<size_t>(1, static_cast<size_t>(workload.size * scale)), repeats);
+        if (line.empty()) continue;
+
+        std::cout << (first ? "  " : ", ") << line << std::endl;
+        first = false;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
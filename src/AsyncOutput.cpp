@@ -0,0 +1,173 @@
+#include "AsyncOutput.hpp"
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        int written = _write(fd, data, static_cast<unsigned int>(std::min<size_t>(size, 1 << 30)));
+        if (written < 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+#else
+/**
+* @brief Writes every part, continuing after partial writes and interrupts.
+*/
+bool writeAll(int fd, iovec* parts, int count) {
+    while (count > 0) {
+        ssize_t written = ::writev(fd, parts, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        while (count > 0 && static_cast<size_t>(written) >= parts->iov_len) {
+            written -= static_cast<ssize_t>(parts->iov_len);
+            parts++;
+            count--;
+        }
+        if (count > 0) {
+            parts->iov_base = static_cast<char*>(parts->iov_base) + written;
+            parts->iov_len -= static_cast<size_t>(written);
+        }
+    }
+    return true;
+}
+#endif
+
+size_t ringSize(size_t capacity) {
+    size_t size = 64;
+    while (size < capacity) size <<= 1;
+    return size;
+}
+
+}
+
+AsyncOutput::AsyncOutput(int fd, size_t capacity)
+    : fd(fd), ring(std::make_unique<char[]>(ringSize(capacity))), mask(ringSize(capacity) - 1), batch(std::min<size_t>(64 << 10, (mask + 1) / 2)),
+    writer(&AsyncOutput::drain, this) {
+}
+
+AsyncOutput::~AsyncOutput() {
+    close();
+}
+
+void AsyncOutput::write(std::string_view text) {
+    if (closed) return;
+
+    const size_t capacity = mask + 1;
+    size_t position = tail.load(std::memory_order_relaxed);
+    while (!text.empty()) {
+        // Backpressure, waits for the writer while the ring is full
+        while (position - cachedHead == capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == capacity) head.wait(cachedHead, std::memory_order_acquire);
+        }
+
+        const size_t count = std::min(text.size(), capacity - (position - cachedHead));
+        const size_t offset = position & mask;
+        const size_t first = std::min(count, capacity - offset);
+        std::memcpy(ring.get() + offset, text.data(), first);
+        std::memcpy(ring.get(), text.data() + first, count - first);
+
+        position += count;
+        text.remove_prefix(count);
+        tail.store(position, std::memory_order_seq_cst);
+
+        // Pairs with the writer storing its state before looking at tail, one of both sees the other
+        Writer state = writerState.load(std::memory_order_seq_cst);
+        if (state == Writer::Empty || (state == Writer::Collecting && position - head.load(std::memory_order_relaxed) >= batch)) {
+            wake();
+        }
+    }
+}
+
+void AsyncOutput::flush() {
+    const size_t target = tail.load(std::memory_order_relaxed) & ~Closed;
+    size_t written = head.load(std::memory_order_acquire);
+    if (written == target) return;
+
+    urgent.store(true, std::memory_order_seq_cst);
+    wake();
+    while (written != target) {
+        head.wait(written, std::memory_order_acquire);
+        written = head.load(std::memory_order_acquire);
+    }
+    urgent.store(false, std::memory_order_relaxed);
+}
+
+void AsyncOutput::close() {
+    if (closed) return;
+
+    closed = true;
+    tail.fetch_or(Closed, std::memory_order_seq_cst);
+    wake();
+    writer.join();
+}
+
+void AsyncOutput::wake() {
+    // Taking the mutex makes sure the writer is either waiting already or still going to look at tail
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeUp.notify_one();
+}
+
+void AsyncOutput::drain() {
+    const size_t capacity = mask + 1;
+    size_t position = 0;
+    while (true) {
+        size_t end = tail.load(std::memory_order_acquire);
+
+        // Sleeps until there is output, then lets more of it collect for a moment, so it goes out in few large writes
+        if (!(end & Closed) && end - position < batch && !urgent.load(std::memory_order_relaxed)) {
+            const Writer state = (end == position) ? Writer::Empty : Writer::Collecting;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            writerState.store(state, std::memory_order_seq_cst);
+            auto ready = [&] {
+                end = tail.load(std::memory_order_seq_cst);
+                return (end & Closed) || urgent.load(std::memory_order_seq_cst) || end - position >= batch
+                    || (state == Writer::Empty && end != position);
+            };
+            if (state == Writer::Empty) {
+                wakeUp.wait(lock, ready);
+                writerState.store(Writer::Awake, std::memory_order_relaxed);
+                continue;
+            }
+            wakeUp.wait_for(lock, std::chrono::milliseconds(1), ready);
+            writerState.store(Writer::Awake, std::memory_order_relaxed);
+        }
+
+        // Everything written so far goes out in one call, the part wrapping around the ring included
+        const size_t available = (end & ~Closed) - position;
+        if (available > 0) {
+            const size_t offset = position & mask;
+            const size_t first = std::min(available, capacity - offset);
+            if (!failed.load(std::memory_order_relaxed)) {
+#ifdef _WIN32
+                bool written = writeAll(fd, ring.get() + offset, first) && writeAll(fd, ring.get(), available - first);
+#else
+                iovec parts[2] = { { ring.get() + offset, first }, { ring.get(), available - first } };
+                bool written = writeAll(fd, parts, (available > first) ? 2 : 1);
+#endif
+                if (!written) failed.store(true, std::memory_order_relaxed);
+            }
+
+            position += available;
+            head.store(position, std::memory_order_release);
+            head.notify_all();
+        }
+
+        if (end & Closed) return;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+* @brief Output sink handing the bytes to a writer thread, which writes them to a file descriptor in large writes.
+* @details The bytes go through a lock-free ring between the executing thread and the writer.
+*   The writer lets output collect for up to a millisecond or until a batch is full, and write only wakes it
+*   when it sleeps on an empty ring or a full batch. Once the ring is full, write waits for the writer.
+*   Everything written is on the file descriptor once flush, close or the destructor returns,
+*   and the output before a warning is if std::cerr is tied to flushing().
+*/
+class AsyncOutput : public OutputSink {
+public:
+    /**
+    * @param fd The file descriptor to write to, standard output by default.
+    * @param capacity The size of the ring in bytes, rounded up to a power of two.
+    */
+    explicit AsyncOutput(int fd = 1, size_t capacity = 1 << 20);
+    ~AsyncOutput() override;
+
+    AsyncOutput(const AsyncOutput&) = delete;
+    AsyncOutput& operator=(const AsyncOutput&) = delete;
+
+    void write(std::string_view text) override;
+
+    /**
+    * @brief Waits until the writer has written everything written so far.
+    */
+    void flush();
+
+    /**
+    * @brief Flushes and stops the writer, later writes are dropped.
+    */
+    void close();
+
+    /**
+    * @brief A stream whose flush flushes this output, a stream tied to it waits for the output before writing.
+    */
+    std::ostream& flushing() { return flushStream; }
+
+    /**
+    * @return false if a write to the file descriptor failed, the output after it was dropped.
+    */
+    bool good() const { return !failed.load(std::memory_order_relaxed); }
+
+private:
+    class FlushBuffer : public std::streambuf {
+    public:
+        explicit FlushBuffer(AsyncOutput& output) : output(output) {}
+
+    protected:
+        int sync() override {
+            output.flush();
+            return 0;
+        }
+
+    private:
+        AsyncOutput& output;
+    };
+
+    enum class Writer : int { Awake, Empty, Collecting };
+
+    void drain();
+    void wake();
+
+    const int fd;
+    std::unique_ptr<char[]> ring;
+    const size_t mask;
+    const size_t batch;                                 // Bytes the writer waits for before writing without delay
+
+    static constexpr size_t Closed = size_t(1) << 63;   // Set in tail by close, so the writer wakes up and ends
+
+    // Apart, so the executing thread and the writer do not invalidate each other's cache line on every write
+    alignas(64) std::atomic<size_t> tail{ 0 };          // Bytes written into the ring
+    size_t cachedHead = 0;
+    bool closed = false;
+    alignas(64) std::atomic<size_t> head{ 0 };          // Bytes written to the file descriptor
+    std::atomic<Writer> writerState{ Writer::Awake };
+    std::atomic<bool> urgent{ false };                  // A flush waits, the writer does not wait for more output
+    std::atomic<bool> failed{ false };
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+
+    FlushBuffer flushBuffer{ *this };
+    std::ostream flushStream{ &flushBuffer };
+    std::thread writer;
+};
@@ -1,44 +1,100 @@
 #include "AwaInterpreter.hpp"
+#include "Awabler.hpp"
+#include "LoopIdioms.hpp"
+#include <limits>
+#include <unordered_map>
+
+/**
+* @brief Copies a bubble into the arena of this thread, a list shared within the bubbles stays shared in the copy.
+*/
+static Bubble copyBubble(const Bubble& bubble, std::unordered_map<const BubbleList*, std::shared_ptr<BubbleList>>& copied) {
+    if (!isDouble(bubble)) {
+        return bubble;
+    }
 
-static std::map<int, std::string> AwatismsMap = {
-    {0, "nop"},
-    {1, "prn"},
-    {2, "pr1"},
-    {3, "red"},
-    {4, "r3d"},
-    {5, "blw"},
-    {6, "sbm"},
-    {7, "pop"},
-    {8, "dpl"},
-    {9, "srn"},
-    {10, "mrg"},
-    {11, "4dd"},
-    {12, "sub"},
-    {13, "mul"},
-    {14, "div"},
-    {15, "cnt"},
-    {16, "lbl"},
-    {17, "jmp"},
-    {18, "eql"},
-    {19, "lss"},
-    {20, "gr8"},
-	{21, "mov"},
-    {31, "trm"}
-};
-
-static std::string reverse(int value) {
-    auto it = AwatismsMap.find(value);
-    if (it != AwatismsMap.end()) {
-        return it->second;
+    const BubbleList& list = getList(bubble);
+    std::shared_ptr<BubbleList>& copy = copied[&list];
+    if (!copy) {
+        BubbleVector elements;
+        elements.reserve(list.size());
+        for (const Bubble& element : list) {
+            elements.push_back(copyBubble(element, copied));
+        }
+        copy = std::allocate_shared<BubbleList>(ArenaAllocator<BubbleList>(), std::move(elements));
+        copy->count = list.count;
     }
-    return "undefined";
+
+    Bubble result(0);
+    result.value = copy;
+    return result;
+}
+
+VmState::VmState(const VmState& other) {
+    *this = other;
+}
+
+VmState& VmState::operator=(const VmState& other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    std::shared_ptr<BubbleArena> own = other.arena ? std::make_shared<BubbleArena>() : nullptr;
+    std::unordered_map<const BubbleList*, std::shared_ptr<BubbleList>> copied;
+    std::vector<Bubble> abyss;
+    std::vector<StacktraceEntry> trace;
+    {
+        BubbleArena::Scope arenaScope(own.get());
+        abyss.reserve(other.bubbleAbyss.size());
+        for (const Bubble& bubble : other.bubbleAbyss) {
+            abyss.push_back(copyBubble(bubble, copied));
+        }
+
+        trace.reserve(other.stacktrace.size());
+        for (const StacktraceEntry& entry : other.stacktrace) {
+            trace.push_back({ entry.executionTime, entry.instruction, {}, entry.registers });
+            trace.back().stack.reserve(entry.stack.size());
+            for (const Bubble& bubble : entry.stack) {
+                trace.back().stack.push_back(copyBubble(bubble, copied));
+            }
+        }
+    }
+
+    // The old bubbles go back to the old arena before it is released
+    bubbleAbyss = std::move(abyss);
+    stacktrace = std::move(trace);
+    arena = std::move(own);
+    copyScalars(other);
+    return *this;
 }
 
-std::pair<std::vector<StacktraceEntry>, bool> AwaInterpreter::run(const std::string& code, const std::string& input, const bool isDebug) {
-    bubbleAbyss.clear();
-    stacktrace.clear();
+VmState VmState::share() const {
+    VmState copy(arena);
+    copy.bubbleAbyss = bubbleAbyss;
+    copy.stacktrace = stacktrace;
+    copy.copyScalars(*this);
+    return copy;
+}
+
+void VmState::copyScalars(const VmState& other) {
+    bubblePond = other.bubblePond;
+    pc = other.pc;
+    executionStep = other.executionStep;
+    terminated = other.terminated;
+    limits = other.limits;
+    bubbleCount = other.bubbleCount;
+    deadline = other.deadline;
+    backwardJumps = other.backwardJumps;
+    recordTrace = other.recordTrace;
+    recordProfile = other.recordProfile;
+    profile = other.profile;
+}
+
+RunResult AwaInterpreter::run(const std::string& code, const std::string& input, const bool isDebug, const ExecutionLimits& limits, WarningSink* warnings) {
+    return run(compile(code), input, isDebug, limits, warnings);
+}
 
-    data = ReadAwatalk(code);
+RunResult AwaInterpreter::run(std::shared_ptr<const CompiledProgram> program, const std::string& input, const bool isDebug, const ExecutionLimits& limits, WarningSink* warnings) {
+    const std::vector<int>& data = program->data;
     
     if (isDebug) {
         for (int i = 0; i < data.size();) {
@@ -49,205 +105,157 @@ std::pair<std::vector<StacktraceEntry>, bool> AwaInterpreter::run(const std::str
         std::cout << std::endl;
     }
 
-    buildLabelTable();
+    VmState state;
+    state.recordTrace = isDebug;
+    state.setLimits(limits);
+    StringInput inputSource(input);
+    StreamOutput output(std::cout);
+    StreamWarningSink defaultWarnings;
 
     std::cout << "Output:" << std::endl;
-    executeInstructions(input);
+    ExecuteStatus status = execute(*program, state, { inputSource, output, warnings ? *warnings : defaultWarnings });
+    if (!warnings) defaultWarnings.summary();
 
-    return std::make_pair(stacktrace, AwaInterpreter::legacy);
+    return { state.arena, std::move(state.stacktrace), program->legacy, status, state.executionStep };
 }
 
-std::vector<int> AwaInterpreter::ReadAwatalk(const std::string& awa) {
-    std::vector<int> instructions;
-
-    size_t awaIndex = 0;
-    for (; awaIndex < awa.size() - 6; awaIndex++) {
-        if (awa.substr(awaIndex, 6) == "awawa ") {
-            AwaInterpreter::legacy = false;
-            awaIndex += 5;
-            break;
-        }
-
-        if (awa.substr(awaIndex, 4) == "awa ") {
-            AwaInterpreter::legacy = true;
-            awaIndex += 3;
-            break;
-        }
-    }
-    if (awaIndex >= awa.size() - (AwaInterpreter::legacy ? 3 : 5)) {
-        return instructions;
-    }
-
-    int bitCounter = 0;
-    int targetBit = 5;
-    int newValue = 0;
-    std::vector<int> bitsToRead;
-	bool param = false;
-    bool signed_ = false;       // Rename due to collision with the "signed" keyword
-    bool newInstruction = true;
-
-	bool previousValueDependent = false;    // Would only be true if non-legacy
-    int previousInstruction = -1;
+std::shared_ptr<const CompiledProgram> AwaInterpreter::compile(const std::string& code) {
+    auto program = std::make_shared<CompiledProgram>();
+    program->data = ReadAwatalk(code, program->legacy);
+    program->lblTable = buildLabelTable(program->data);
+    LoopIdioms::recognize(*program);
 
-    while (awaIndex < awa.size() - 1) {
-        if (awa.substr(awaIndex, 2) == "wa") {
-            if (targetBit == 8 && bitCounter == 0 && signed_) {
-                newValue = -1;
-            }
-            else {
-                newValue = (newValue << 1) + 1;
-            }
-            awaIndex += 2;
-            bitCounter++;
-        }
-        else if (awaIndex < awa.size() - 3 && awa.substr(awaIndex, 4) == " awa") {
-            bitCounter++;
-            newValue <<= 1;
-            awaIndex += 4;
-        }
-        else {
-            awaIndex++;
-        }
+    return program;
+}
 
-        if (bitCounter >= targetBit) {
-            instructions.push_back(newValue);
+std::shared_ptr<const CompiledProgram> AwaInterpreter::compileAwably(const std::string& code) {
+    return compileAwably(code, Awabler::legacy, *Awabler::warnings);
+}
 
-            bitCounter = 0;
+std::shared_ptr<const CompiledProgram> AwaInterpreter::compileAwably(const std::string& code, bool legacy, WarningSink& warnings) {
+    auto program = std::make_shared<CompiledProgram>();
+    program->legacy = legacy;
+    appendAwably(*program, code, warnings);
+    LoopIdioms::recognize(*program);
 
-            // For conditionals
-            if (previousValueDependent) {
-                previousValueDependent = false;
+    return program;
+}
 
-                switch (previousInstruction) {
-                case blw:
-                    if (newValue) {
-                        signed_ = false;
-                        bitsToRead.push_back(4);
-                    }
-                    else {
-                        signed_ = true;
-                        bitsToRead.push_back(8);
-                    }
-                    break;
-                case mov:
-                    if (newValue) {
-                        signed_ = false;
-                        bitsToRead.insert(bitsToRead.end(), { 4, 4 });
-                    }
-                    else {
+void AwaInterpreter::appendAwably(CompiledProgram& program, const std::string& code) {
+    appendAwably(program, code, *Awabler::warnings);
+}
 
-                        signed_ = true;
-                        bitsToRead.insert(bitsToRead.end(), { 4, 8 });
-                    }
-                    break;
-                case sbm:
-				case srn:
-				case jmp:
-                    signed_ = false;
-                    if (newValue) {
-                        bitsToRead.push_back(4);
-                    }
-                    else {
-                        bitsToRead.push_back(5);
-                    }
-					break;
-                default:
-                    break;
-                }
-            }
+void AwaInterpreter::appendAwably(CompiledProgram& program, const std::string& code, WarningSink& warnings) {
+    std::vector<Awabler::LineResult> lines = Awabler::parseCode(code, program.legacy, warnings);
+    std::vector<int>& data = program.data;
+    const size_t start = data.size();
 
-            if (newInstruction) {
-				previousInstruction = newValue;
-
-                if (!AwaInterpreter::legacy) {
-                    switch (newValue) {
-                        case blw:
-                            signed_ = false;
-                            bitsToRead.push_back(1);
-					    	previousValueDependent = true;
-                            break;
-                        case sbm:
-                        case srn:
-                        case jmp:
-                            signed_ = false;
-                            bitsToRead.push_back(1);
-							previousValueDependent = true;
-                            break;
-                        case pop:
-                            signed_ = false;
-                            bitsToRead.push_back(4);
-                            break;
-                        case mov:
-                            signed_ = false;
-							bitsToRead.push_back(1);
-							previousValueDependent = true;
-                            break;
-                        default:
-                            break;
-                    }
-                } else {
-                    switch (newValue) {
-                        case blw:
-                            signed_ = true;
-                            bitsToRead.push_back(8);
-                            break;
-                        case sbm:
-                        case srn:
-                        case jmp:
-                        case lbl:
-                            signed_ = false;
-                            bitsToRead.push_back(5);
-                            break;
-                        default:
-                            break;
-                    }
-                }
+    if (program.legacy) {
+        // The legacy layout is fixed, every value is masked to its width and parameters of 8 bits are signed
+        // Grows geometrically, appending one line at a time must not reallocate every time
+        if (data.capacity() < start + lines.size() * 2) {
+            data.reserve(std::max(start + lines.size() * 2, data.capacity() * 2));
+        }
+        for (const Awabler::LineResult& line : lines) {
+            data.push_back(line.instructionCode & 0x1F);
+            if (line.parameter) {
+                data.push_back((line.parameterLength == 8) ? static_cast<int8_t>(*line.parameter & 0xFF) : (*line.parameter & 0x1F));
             }
-
-            if (bitsToRead.size() == 0) {
-                targetBit = 5;
-                signed_ = false;
-				newInstruction = true;
+        }
+    }
+    else {
+        // AWA5.0++ parameters depend on flag bits the Awabler does not emit, so the bits are decoded as the Awalang would be
+        std::vector<uint8_t> bits;
+        bits.reserve(lines.size() * 13);
+        auto pushBits = [&bits](int value, int length) {
+            for (int i = length - 1; i >= 0; i--) {
+                bits.push_back((value >> i) & 1);
             }
-            else {
-                targetBit = bitsToRead.front();
-				bitsToRead.erase(bitsToRead.begin());
-				newInstruction = false;
+        };
+        for (const Awabler::LineResult& line : lines) {
+            pushBits(line.instructionCode, 5);
+            if (line.parameter) {
+                pushBits(*line.parameter, line.parameterLength);
             }
+        }
 
-            newValue = 0;
+        AwatalkDecoder decoder(false);
+        int value;
+        for (uint8_t bit : bits) {
+            if (decoder.push(bit, value)) data.push_back(value);
         }
     }
 
+    addLabels(data, start, program.lblTable);
+}
+
+std::vector<int> AwaInterpreter::ReadAwatalk(const std::string& awa, bool& legacy) {
+    std::vector<int> instructions;
+    decodeAwalang(awa, legacy, [&instructions](int value, bool) { instructions.push_back(value); });
+
     return instructions;
 }
 
-void AwaInterpreter::buildLabelTable() {
-    lblTable.clear();
-    for (size_t i = 0; i < data.size(); i++) {
-        switch (data[i]) {
-        case lbl:
-            lblTable[data[i + 1]] = i + 1;
-            i++;
-            break;
-        case blw:
-        case sbm:
-        case srn:
-        case jmp:
-            i++;
-            break;
-        default:
-            break;
-        }
-    }
+std::map<int, size_t> AwaInterpreter::buildLabelTable(const std::vector<int>& data) {
+    std::map<int, size_t> lblTable;
+    addLabels(data, 0, lblTable);
+
+    return lblTable;
+}
+
+void AwaInterpreter::addLabels(const std::vector<int>& data, size_t start, std::map<int, size_t>& lblTable) {
+    forEachLabel(data, start, [&lblTable](int label, size_t position) { lblTable[label] = position; });
 }
 
-void AwaInterpreter::executeInstructions(const std::string& input) {
-    size_t i = 0;
-    bool terminate = false;
-    unsigned int executionStep = 0;
+ExecuteStatus AwaInterpreter::execute(const CompiledProgram& program, VmState& state, const VmIo& io, unsigned int sliceSteps) {
+    return program.legacy ? executeDialect<true>(program, state, io, sliceSteps) : executeDialect<false>(program, state, io, sliceSteps);
+}
 
-    while (i < data.size() && !terminate) {
+template <bool legacy>
+ExecuteStatus AwaInterpreter::executeDialect(const CompiledProgram& program, VmState& state, const VmIo& io, unsigned int sliceSteps) {
+    const std::vector<int>& data = program.data;
+    const std::map<int, size_t>& lblTable = program.lblTable;
+    std::vector<Bubble>& bubbleAbyss = state.bubbleAbyss;
+    std::array<int, 16>& bubblePond = state.bubblePond;
+    size_t& i = state.pc;
+    uint64_t& executionStep = state.executionStep;
+    std::string printed;
+    BubbleArena::Scope arenaScope(state.arena.get());
+
+    size_t opStart = i;
+    auto logWarning = [&](WarningCode code, int value = 0) {
+        io.warnings.warn({ WarningSource::Interpreter, code, executionStep, opStart, value });
+    };
+
+    const uint64_t sliceEnd = sliceSteps ? executionStep + sliceSteps : 0;
+
+    // Limits are only checked on backward jumps and when bubbles are blown
+    const bool countingBubbles = state.limits.maxBubbles != 0;
+    const bool checkingJumps = state.limits.maxSteps != 0 || state.deadline != std::chrono::steady_clock::time_point::max();
+    std::optional<ExecuteStatus> limitHit;
+
+    auto pushBubble = [&](Bubble bubble) {
+        if (countingBubbles) {
+            state.bubbleCount += countBubbles(bubble);
+            if (state.bubbleCount > state.limits.maxBubbles) limitHit = ExecuteStatus::MemoryLimit;
+        }
+        bubbleAbyss.push_back(std::move(bubble));
+    };
+    auto popBubble = [&]() {
+        if (countingBubbles) state.bubbleCount -= countBubbles(bubbleAbyss.back());
+        bubbleAbyss.pop_back();
+    };
+
+    while (i < data.size() && !state.terminated && !limitHit) {
+        if (executionStep == sliceEnd && sliceSteps) {
+            // A slice may end before enough backward jumps to read the clock
+            if (checkingJumps && std::chrono::steady_clock::now() >= state.deadline) {
+                return ExecuteStatus::Timeout;
+            }
+            return ExecuteStatus::Yielded;
+        }
+
+        opStart = i;
         int op = data[i];
         switch (op) {
             case nop:
@@ -255,30 +263,39 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
             case prn:
                 if (!bubbleAbyss.empty()) {
                     Bubble bubble = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
-                    printBubble(bubble, false);
+                    popBubble();
+                    printed.clear();
+                    printBubble<legacy>(bubble, false, printed);
+                    io.output.write(printed);
                 }
                 else {
-                    logWarning("Warning: Print attempted to print an empty stack", executionStep);
+                    logWarning(WarningCode::PrintEmpty);
                 }
                 break;
             case pr1:
                 if (!bubbleAbyss.empty()) {
                     Bubble bubble = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
-                    printBubble(bubble, true);
+                    popBubble();
+                    printed.clear();
+                    printBubble<legacy>(bubble, true, printed);
+                    io.output.write(printed);
                 }
                 else {
-                    logWarning("Warning: Print Num attempted to print an empty stack", executionStep);
+                    logWarning(WarningCode::PrintNumEmpty);
                 }
                 break;
             case red: {
+                if (!io.input.ready()) {
+                    return ExecuteStatus::WaitingForInput;
+                }
+
+                std::string_view input = io.input.read();
                 if (input.empty()) {
-                    logWarning("Warning: Read has no input to read", executionStep);
+                    logWarning(WarningCode::ReadNoInput);
                     break;
                 }
 
-                if (AwaInterpreter::legacy) {
+                if constexpr (legacy) {
                     BubbleVector bubbles;
                     for (auto it = input.rbegin(); it != input.rend(); ++it) {
                         char c = *it;
@@ -287,7 +304,7 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
                             bubbles.push_back(Bubble(static_cast<int>(idx)));
                         }
                     }
-                    bubbleAbyss.push_back(Bubble(bubbles));
+                    pushBubble(Bubble(std::move(bubbles)));
                 }
                 else
                 {
@@ -298,42 +315,32 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
                             bubbles.push_back(Bubble(static_cast<int>(uc)));
                         }
                     }
-                    bubbleAbyss.push_back(Bubble(bubbles));
+                    pushBubble(Bubble(std::move(bubbles)));
                 }
                 break;
             }
             case r3d: {
+                if (!io.input.ready()) {
+                    return ExecuteStatus::WaitingForInput;
+                }
+
+                std::string_view input = io.input.read();
                 if (input.empty()) {
-                    logWarning("Warning: Read Num has no input to read", executionStep);
+                    logWarning(WarningCode::ReadNumNoInput);
                     break;
 		    	}
 
-                std::istringstream iss(input);
-                std::string token;
-                int number = 0;
-                bool found = false;
-                while (iss >> token) {
-                    size_t pos = 0;
-                    while (pos < token.size() && (token[pos] == '+' || token[pos] == '-')) ++pos;
-                    if (pos < token.size() && std::isdigit(token[pos])) {
-                        try {
-                            number = std::stoi(token);
-                            found = true;
-                            break;
-                        } catch (...) {}
-                    }
-                }
-                bubbleAbyss.push_back(Bubble(found ? number : 0));
+                pushBubble(Bubble(readNumber(input)));
                 break;
             }
             case blw:
-                if (AwaInterpreter::legacy) {
+                if constexpr (legacy) {
                     if (i + 1 < data.size()) {
                         i++;
-                        bubbleAbyss.push_back(Bubble(data[i]));
+                        pushBubble(Bubble(data[i]));
                     }
                     else {
-                        logWarning("Warning: Blow has no valid argument", executionStep);
+                        logWarning(WarningCode::BlowNoArgument);
                     }
                 }
                 else {
@@ -341,21 +348,21 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
                         if (data[++i]) {
                             int registerIndex = data[++i];
                             if (registerIndex >= 0 && static_cast<size_t>(registerIndex) < bubblePond.size())
-                                bubbleAbyss.push_back(Bubble(bubblePond[registerIndex]));
+                                pushBubble(Bubble(bubblePond[registerIndex]));
                         }
                         else {
-                            bubbleAbyss.push_back(Bubble(data[++i]));
+                            pushBubble(Bubble(data[++i]));
                         }
                     }
                     else {
-                        logWarning("Warning: Blow has no or insufficient valid argument", executionStep);
+                        logWarning(WarningCode::BlowNoArgument);
                     }
                 }
                 break;
             case sbm:
-                if (i + (AwaInterpreter::legacy ? 1 : 2) < data.size()) {
+                if (i + (legacy ? 1 : 2) < data.size()) {
                     int pos = 0;
-                    if (!AwaInterpreter::legacy) {
+                    if constexpr (!legacy) {
 						if (data[++i]) {
                             int registerIndex = data[++i];
                             if (registerIndex >= 0 && static_cast<size_t>(registerIndex) < bubblePond.size())
@@ -378,60 +385,56 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
                         else if (pos > 0 && static_cast<size_t>(pos) <= bubbleAbyss.size()) {
                             bubbleAbyss.insert(bubbleAbyss.end() - pos, bubble);
                         }
+                        else if (countingBubbles) {
+                            state.bubbleCount -= countBubbles(bubble);
+                        }
                     }
                     else {
-                        logWarning("Warning: Submerge attempted to submarge on an empty stack", executionStep);
+                        logWarning(WarningCode::SubmergeEmpty);
                     }
                 }
                 else {
-                    logWarning("Warning: Submerge has no or insufficient valid argument", executionStep);
+                    logWarning(WarningCode::SubmergeNoArgument);
                 }
                 break;
             case pop:
                 if (!bubbleAbyss.empty()) {
                     Bubble bubble = bubbleAbyss.back();
                     bool isDouble = ::isDouble(bubble);
-                    if (!AwaInterpreter::legacy) 
+                    if constexpr (!legacy) 
                     {
                         if (i + 1 < data.size()) {
                             bubblePond[data[++i]] = isDouble ? 0 : getInt(bubble);
                         }
                         else {
-                            logWarning("Warning: Pop has no valid argument", executionStep);
+                            logWarning(WarningCode::PopNoArgument);
 						}
                     }
 
-                    bubbleAbyss.pop_back();
+                    popBubble();
                     if (isDouble) {
-                        BubbleVector list = getList(bubble);
+                        const BubbleVector& list = getList(bubble);
                         for (auto& b : list) {
-                            bubbleAbyss.push_back(b);
+                            pushBubble(b);
                         }
                     }
                 }
                 else {
-                    logWarning("Warning: Pop attempted to pop on an empty stack", executionStep);
+                    logWarning(WarningCode::PopEmpty);
                 }
                 break;
             case dpl:
                 if (!bubbleAbyss.empty()) {
-                    Bubble original = bubbleAbyss.back();
-                    if (isDouble(original)) {
-                        BubbleVector copiedList = getList(original);
-                        bubbleAbyss.push_back(Bubble(copiedList));
-                    }
-                    else {
-                        bubbleAbyss.push_back(Bubble(getInt(original)));
-                    }
+                    pushBubble(bubbleAbyss.back());
                 }
                 else {
-                    logWarning("Warning: Duplicate attempted to duplicate on an empty stack", executionStep);
+                    logWarning(WarningCode::DuplicateEmpty);
                 }
                 break;
             case srn:
-                if (i + (AwaInterpreter::legacy ? 1 : 2) < data.size()) {
+                if (i + (legacy ? 1 : 2) < data.size()) {
                     int count = 0;
-					if (!AwaInterpreter::legacy) {
+					if constexpr (!legacy) {
                         if (data[++i]) {
                             int registerIndex = data[++i];
                             if (registerIndex >= 0 && static_cast<size_t>(registerIndex) < bubblePond.size())
@@ -450,8 +453,7 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
 
                         for (int idx = 0; idx < count; ++idx) {
                             if (isDouble(bubbleAbyss[bubbleAbyss.size() - 1 - idx])) {
-                                totalWarnings++;
-                                 std::cerr << "[AwaInterpreter] " << "[" << std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Surround on step " << executionStep << " attempted to surround a double bubble." << std::endl;
+                                logWarning(WarningCode::SurroundDouble);
 
                                 break;
                             }
@@ -460,125 +462,129 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
                         BubbleVector newBubble;
                         while (count-- > 0) {
                             newBubble.insert(newBubble.begin(), bubbleAbyss.back());
-                            bubbleAbyss.pop_back();
+                            popBubble();
                         }
-                        bubbleAbyss.push_back(Bubble(newBubble));
+                        pushBubble(Bubble(std::move(newBubble)));
                     }
                 }
                 else {
-                    logWarning("Warning: Surround has no or insufficient valid argument", executionStep);
+                    logWarning(WarningCode::SurroundNoArgument);
                 }
                 break;
             case mrg:
                 if (bubbleAbyss.size() >= 2) {
                     Bubble bubble1 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
+                    popBubble();
                     Bubble bubble2 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
-                    bool b1Double = isDouble(bubble1);
-                    bool b2Double = isDouble(bubble2);
-                    if (!b1Double && !b2Double) {
-                        BubbleVector newBubble;
-                        newBubble.push_back(bubble2);
-                        newBubble.push_back(bubble1);
-                        bubbleAbyss.push_back(Bubble(newBubble));
-                    }
-                    else if (b1Double && !b2Double) {
-                        BubbleVector list = getList(bubble1);
-                        list.push_back(bubble2);
-                        bubbleAbyss.push_back(Bubble(list));
-                    }
-                    else if (!b1Double && b2Double) {
-                        BubbleVector list = getList(bubble2);
-                        list.insert(list.begin(), bubble1);
-                        bubbleAbyss.push_back(Bubble(list));
-                    }
-                    else {
-                        BubbleVector list1 = getList(bubble1);
-                        BubbleVector list2 = getList(bubble2);
-                        list1.insert(list1.begin(), list2.begin(), list2.end());
-                        bubbleAbyss.push_back(Bubble(list1));
-                    }
+                    popBubble();
+                    pushBubble(mergeBubbles(std::move(bubble1), std::move(bubble2)));
                 }
                 else {
-                    logWarning("Warning: Merge attempted to merge on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::MergeShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 break;
             case add:
                 if (bubbleAbyss.size() >= 2) {
                     Bubble bubble1 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
+                    popBubble();
                     Bubble bubble2 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
-                    bubbleAbyss.push_back(addBubbles(bubble1, bubble2));
+                    popBubble();
+                    pushBubble(addBubbles(bubble1, bubble2));
                 }
                 else {
-                    logWarning("Warning: Add attempted to add on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::AddShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 break;
             case sub:
                 if (bubbleAbyss.size() >= 2) {
                     Bubble bubble1 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
+                    popBubble();
                     Bubble bubble2 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
-                    bubbleAbyss.push_back(subBubbles(bubble1, bubble2));
+                    popBubble();
+                    pushBubble(subBubbles(bubble1, bubble2));
                 }
                 else {
-                    logWarning("Warning: Subtract attempted to subtract on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::SubtractShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 break;
             case mul:
                 if (bubbleAbyss.size() >= 2) {
                     Bubble bubble1 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
+                    popBubble();
                     Bubble bubble2 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
-                    bubbleAbyss.push_back(mulBubbles(bubble1, bubble2));
+                    popBubble();
+                    pushBubble(mulBubbles(bubble1, bubble2));
                 }
                 else {
-                    logWarning("Warning: Multiply attempted to multiply on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::MultiplyShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 break;
             case div_:
                 if (bubbleAbyss.size() >= 2) {
                     Bubble bubble1 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
+                    popBubble();
                     Bubble bubble2 = bubbleAbyss.back();
-                    bubbleAbyss.pop_back();
-                    bubbleAbyss.push_back(divBubbles(bubble1, bubble2));
+                    popBubble();
+                    pushBubble(divBubbles(bubble1, bubble2));
                 }
                 else {
-                    logWarning("Warning: Division attempted to divide on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::DivideShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 break;
             case cnt:
                 if (!bubbleAbyss.empty()) {
-                    Bubble bubble = bubbleAbyss.back();
+                    const Bubble& bubble = bubbleAbyss.back();
                     if (isDouble(bubble)) {
-                        BubbleVector list = getList(bubble);
-                        bubbleAbyss.push_back(Bubble(static_cast<int>(list.size())));
+                        pushBubble(Bubble(static_cast<int>(getList(bubble).size())));
                     }
                     else {
-                        bubbleAbyss.push_back(Bubble(0));
+                        pushBubble(Bubble(0));
                     }
                 }
                 else {
-                    bubbleAbyss.push_back(Bubble(0));
+                    pushBubble(Bubble(0));
                 }
                 break;
             case lbl:
                 if (i + 1 < data.size()) {
+                    // A recognized loop entered from above runs natively, as long as it ends within the step and slice limits
+                    if (!program.loops.empty() && !state.recordTrace && !state.recordProfile) {
+                        auto loop = program.loops.find(i);
+                        if (loop != program.loops.end()) {
+                            uint64_t maxSteps = std::numeric_limits<uint64_t>::max();
+                            if (state.limits.maxSteps) maxSteps = std::min(maxSteps, state.limits.maxSteps - std::min(state.limits.maxSteps, executionStep + 1));
+                            if (sliceSteps) maxSteps = std::min(maxSteps, sliceEnd - executionStep - 1);
+
+                            LoopIdioms::Outcome outcome = LoopIdioms::run(loop->second, state, maxSteps);
+                            if (outcome.timedOut) {
+                                // Stopped on the head of the loop, like a jmp to its label
+                                executionStep += outcome.steps;
+                                limitHit = ExecuteStatus::Timeout;
+                                i++;
+                                break;
+                            }
+                            if (outcome.steps) {
+                                executionStep += outcome.steps;
+                                i = loop->second.exit;
+                                break;
+                            }
+                        }
+                    }
                     i++;
                 }
                 else {
-                    logWarning("Warning: Label has no valid argument", executionStep);
+                    logWarning(WarningCode::LabelNoArgument);
                 }
                 break;
             case jmp:
-                if (i + (AwaInterpreter::legacy ? 1 : 2) < data.size()) {
+                // A later lbl may still redefine the label
+                if (!program.complete) {
+                    return ExecuteStatus::WaitingForCode;
+                }
+
+                if (i + (legacy ? 1 : 2) < data.size()) {
                     int label = 0;
-                    if (!AwaInterpreter::legacy) {
+                    if constexpr (!legacy) {
                         if (data[++i]) {
                             int registerIndex = data[++i];
                             if (registerIndex >= 0 && static_cast<size_t>(registerIndex) < bubblePond.size())
@@ -592,62 +598,71 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
                         label = data[++i];
 					}
 
-                    if (lblTable.find(label) != lblTable.end()) {
-                        i = lblTable[label];
+                    auto target = lblTable.find(label);
+                    if (target != lblTable.end()) {
+                        if (checkingJumps && target->second < i) {
+                            if (state.limits.maxSteps && executionStep >= state.limits.maxSteps) {
+                                limitHit = ExecuteStatus::StepLimit;
+                            }
+                            else if ((++state.backwardJumps & 0xFF) == 0 && std::chrono::steady_clock::now() >= state.deadline) {
+                                limitHit = ExecuteStatus::Timeout;
+                            }
+                        }
+                        i = target->second;
                     }
                     else {
-                        logWarning("Warning: Jump attempted to jump to a non-existing label " + std::to_string(label), executionStep);
+                        logWarning(WarningCode::JumpMissingLabel, label);
                     }
                 }
                 else {
-                    logWarning("Warning: Jump has no valid argument", executionStep);
+                    logWarning(WarningCode::JumpNoArgument);
                 }
                 break;
             case eql:
                 if (bubbleAbyss.size() < 2) {
-                    logWarning("Warning: Equal attempted to compare on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::EqualShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 else {
-                    Bubble b1 = bubbleAbyss.back();
-                    Bubble b2 = bubbleAbyss[bubbleAbyss.size() - 2];
+                    const Bubble& b1 = bubbleAbyss.back();
+                    const Bubble& b2 = bubbleAbyss[bubbleAbyss.size() - 2];
                     if (!isDouble(b1) && !isDouble(b2) && getInt(b1) == getInt(b2)) {
                     }
                     else {
-                        skipNextInstruction(i);
+                        skipNextInstruction(data, i);
                     }
                 }
                 break;
             case lss:
                 if (bubbleAbyss.size() < 2) {
-                    logWarning("Warning: Less Than attempted to compare on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::LessShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 else {
-                    Bubble b1 = bubbleAbyss.back();
-                    Bubble b2 = bubbleAbyss[bubbleAbyss.size() - 2];
+                    const Bubble& b1 = bubbleAbyss.back();
+                    const Bubble& b2 = bubbleAbyss[bubbleAbyss.size() - 2];
                     if (!isDouble(b1) && !isDouble(b2) && getInt(b1) < getInt(b2)) {
                     }
                     else {
-                        skipNextInstruction(i);
+                        skipNextInstruction(data, i);
                     }
                 }
                 break;
             case gr8:
                 if (bubbleAbyss.size() < 2) {
-                    logWarning("Warning: Greater Than attempted to compare on a stack with " + std::to_string(bubbleAbyss.size()) + " bubbles", executionStep);
+                    logWarning(WarningCode::GreaterShortStack, static_cast<int>(bubbleAbyss.size()));
                 }
                 else {
-                    Bubble b1 = bubbleAbyss.back();
-                    Bubble b2 = bubbleAbyss[bubbleAbyss.size() - 2];
+                    const Bubble& b1 = bubbleAbyss.back();
+                    const Bubble& b2 = bubbleAbyss[bubbleAbyss.size() - 2];
                     if (!isDouble(b1) && !isDouble(b2) && getInt(b1) > getInt(b2)) {
                     }
                     else {
-                        skipNextInstruction(i);
+                        skipNextInstruction(data, i);
                     }
                 }
                 break;
             case mov:
-                if (AwaInterpreter::legacy) {
-                    logWarning("Warning: Move is not supported in legacy mode", executionStep);
+                if constexpr (legacy) {
+                    logWarning(WarningCode::MoveInLegacy);
                 } else {
                     if (i + 3 < data.size()) {
                         bool isSecondParamReg = data[++i];
@@ -662,22 +677,30 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
                         }
                     }
                     else {
-                        logWarning("Warning: Move has no or insufficient valid arguments", executionStep);
+                        logWarning(WarningCode::MoveNoArgument);
                     }
                 }
                 break;
             case trm:
-                terminate = true;
+                state.terminated = true;
                 break;
         }
 
+        executionStep++;
+        if (state.recordProfile) state.profile[op & 0x1F]++;
+
+        if (!state.recordTrace) {
+            i++;
+            continue;
+        }
+
         std::string argument;
         switch (op) {
         case jmp:
         case sbm:
         case srn:
         case blw:
-            if (!AwaInterpreter::legacy) {
+            if constexpr (!legacy) {
                 argument = (data[i - 1] ? "r" : "") + std::to_string(data[i]);
             }
             else {
@@ -688,7 +711,7 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
             argument = std::to_string(data[i]);
             break;
         case pop:
-            if (!AwaInterpreter::legacy) {
+            if constexpr (!legacy) {
                 argument = "r" + std::to_string(data[i]);
 			}
             break;
@@ -699,37 +722,63 @@ void AwaInterpreter::executeInstructions(const std::string& input) {
             break;
         }
 
-        executionStep++;
         i++;
 
-        stacktrace.push_back({executionStep, reverse(op) + " " + argument, bubbleAbyss, bubblePond});
+        state.stacktrace.push_back({executionStep, std::string(awatismName(op)) + " " + argument, bubbleAbyss, bubblePond});
     }
-}
 
-void AwaInterpreter::skipNextInstruction(size_t& i) {
-    if (i + 1 < data.size()) {
-        int nextOp = data[i + 1];
-        switch (nextOp) {
-        case pop:
-        case lbl:
-        case jmp:
-            i += 2;
-            break;
+    if (limitHit) {
+        return *limitHit;
+    }
 
-        case blw:
-        case sbm:
-        case srn:
-            i += 3;
-            break;
+    if (!state.terminated && !program.complete) {
+        return ExecuteStatus::WaitingForCode;
+    }
 
-        case mov:
-            i += 4;
-			break;
-        default:
-            i++;
-            break;
+    return state.terminated ? ExecuteStatus::Terminated : ExecuteStatus::Finished;
+}
+
+const char* describe(ExecuteStatus status) {
+    switch (status) {
+    case ExecuteStatus::Finished:
+        return "finished";
+    case ExecuteStatus::Terminated:
+        return "terminated";
+    case ExecuteStatus::Yielded:
+        return "yielded";
+    case ExecuteStatus::WaitingForInput:
+        return "waiting for input";
+    case ExecuteStatus::StepLimit:
+        return "step limit exceeded";
+    case ExecuteStatus::MemoryLimit:
+        return "bubble limit exceeded";
+    case ExecuteStatus::Timeout:
+        return "timed out";
+    case ExecuteStatus::WaitingForCode:
+        return "waiting for code";
+    }
+    return "undefined";
+}
+
+int AwaInterpreter::readNumber(std::string_view input) {
+    std::istringstream iss{std::string(input)};
+    std::string token;
+    while (iss >> token) {
+        size_t pos = 0;
+        while (pos < token.size() && (token[pos] == '+' || token[pos] == '-')) ++pos;
+        if (pos < token.size() && std::isdigit(token[pos])) {
+            try {
+                return std::stoi(token);
+            } catch (...) {}
         }
     }
+    return 0;
+}
+
+void AwaInterpreter::skipNextInstruction(const std::vector<int>& data, size_t& i) {
+    if (i + 1 < data.size()) {
+        i += skippedLength(data[i + 1]);
+    }
     else {
         i++;
     }
@@ -744,25 +793,51 @@ Bubble AwaInterpreter::addBubbles(const Bubble& a, const Bubble& b) {
         for (auto& elem : list) {
             elem = addBubbles(elem, b);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else if (!isDouble(a) && isDouble(b)) {
         BubbleVector list = getList(b);
         for (auto& elem : list) {
             elem = addBubbles(a, elem);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else {
-        BubbleVector listA = getList(a);
-        BubbleVector listB = getList(b);
+        const BubbleVector& listA = getList(a);
+        const BubbleVector& listB = getList(b);
         BubbleVector newList;
         size_t minSize = std::min(listA.size(), listB.size());
         for (size_t i = 0; i < minSize; i++) {
             BubbleVector temp = getList(addBubbles(listA[i], listB[i]));
             newList.insert(newList.end(), temp.begin(), temp.end());
         }
-        return Bubble(newList);
+        return Bubble(std::move(newList));
+    }
+}
+
+Bubble AwaInterpreter::mergeBubbles(Bubble bubble1, Bubble bubble2) {
+    bool b1Double = isDouble(bubble1);
+    bool b2Double = isDouble(bubble2);
+    if (!b1Double && !b2Double) {
+        BubbleVector newBubble;
+        newBubble.push_back(bubble2);
+        newBubble.push_back(bubble1);
+        return Bubble(std::move(newBubble));
+    }
+    else if (b1Double && !b2Double) {
+        editList(bubble1).push_back(bubble2);
+        return bubble1;
+    }
+    else if (!b1Double && b2Double) {
+        BubbleVector& list = editList(bubble2);
+        list.insert(list.begin(), bubble1);
+        return bubble2;
+    }
+    else {
+        const BubbleVector& list2 = getList(bubble2);
+        BubbleVector& list1 = editList(bubble1);
+        list1.insert(list1.begin(), list2.begin(), list2.end());
+        return bubble1;
     }
 }
 
@@ -775,25 +850,25 @@ Bubble AwaInterpreter::subBubbles(const Bubble& a, const Bubble& b) {
         for (auto& elem : list) {
             elem = subBubbles(elem, b);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else if (!isDouble(a) && isDouble(b)) {
         BubbleVector list = getList(b);
         for (auto& elem : list) {
             elem = subBubbles(a, elem);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else {
-        BubbleVector listA = getList(a);
-        BubbleVector listB = getList(b);
+        const BubbleVector& listA = getList(a);
+        const BubbleVector& listB = getList(b);
         BubbleVector newList;
         size_t minSize = std::min(listA.size(), listB.size());
         for (size_t i = 0; i < minSize; i++) {
             BubbleVector temp = getList(subBubbles(listA[i], listB[i]));
             newList.insert(newList.end(), temp.begin(), temp.end());
         }
-        return Bubble(newList);
+        return Bubble(std::move(newList));
     }
 }
 
@@ -806,25 +881,25 @@ Bubble AwaInterpreter::mulBubbles(const Bubble& a, const Bubble& b) {
         for (auto& elem : list) {
             elem = mulBubbles(elem, b);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else if (!isDouble(a) && isDouble(b)) {
         BubbleVector list = getList(b);
         for (auto& elem : list) {
             elem = mulBubbles(a, elem);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else {
-        BubbleVector listA = getList(a);
-        BubbleVector listB = getList(b);
+        const BubbleVector& listA = getList(a);
+        const BubbleVector& listB = getList(b);
         BubbleVector newList;
         size_t minSize = std::min(listA.size(), listB.size());
         for (size_t i = 0; i < minSize; i++) {
             BubbleVector temp = getList(mulBubbles(listA[i], listB[i]));
             newList.insert(newList.end(), temp.begin(), temp.end());
         }
-        return Bubble(newList);
+        return Bubble(std::move(newList));
     }
 }
 
@@ -851,38 +926,55 @@ Bubble AwaInterpreter::divBubbles(const Bubble& a, const Bubble& b) {
         for (auto& elem : list) {
             elem = divBubbles(elem, b);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else if (!isDouble(a) && isDouble(b)) {
         BubbleVector list = getList(b);
         for (auto& elem : list) {
             elem = divBubbles(a, elem);
         }
-        return Bubble(list);
+        return Bubble(std::move(list));
     }
     else {
-        BubbleVector listA = getList(a);
-        BubbleVector listB = getList(b);
+        const BubbleVector& listA = getList(a);
+        const BubbleVector& listB = getList(b);
         BubbleVector newList;
         size_t minSize = std::min(listA.size(), listB.size());
         for (size_t i = 0; i < minSize; i++) {
             BubbleVector temp = getList(divBubbles(listA[i], listB[i]));
             newList.insert(newList.end(), temp.begin(), temp.end());
         }
-        return Bubble(newList);
+        return Bubble(std::move(newList));
+    }
+}
+
+size_t AwaInterpreter::countBubbles(const Bubble& bubble) {
+    if (!isDouble(bubble)) {
+        return 1;
+    }
+
+    const BubbleList& list = getList(bubble);
+    if (list.count == 0) {
+        list.count = 1;
+        for (const Bubble& b : list) {
+            list.count += countBubbles(b);
+        }
     }
+    return list.count;
 }
 
-void AwaInterpreter::printBubble(const Bubble& bubble, bool numbersOut) {
+template <bool legacy>
+void AwaInterpreter::printBubble(const Bubble& bubble, bool numbersOut, std::string& out) {
     if (!isDouble(bubble)) {
         if (numbersOut) {
-            std::cout << getInt(bubble) << " ";
+            out += std::to_string(getInt(bubble));
+            out += ' ';
         }
         else {
             int idx = getInt(bubble);
-            if (AwaInterpreter::legacy) {
+            if constexpr (legacy) {
                 if (idx >= 0 && static_cast<size_t>(idx) < AwaSCII.size()) {
-                    std::cout << AwaSCII[idx];
+                    out += AwaSCII[idx];
                 }
             }
             else {
@@ -890,35 +982,29 @@ void AwaInterpreter::printBubble(const Bubble& bubble, bool numbersOut) {
                 case 0:
                     return;
                 case 9:
-					std::cout << "\t";
+					out += '\t';
                     return;
                 case 10:
-					std::cout << "\n";
+					out += '\n';
                     return;
                 case 13:
-                    std::cout << "\r";
+                    out += '\r';
                     return;
                 default:
                     if (idx >= 32 && idx <= 126) {
-                        std::cout << static_cast<char>(idx);
+                        out += static_cast<char>(idx);
                     }
                     else {
-                        std::cout << "?";
+                        out += '?';
                     }
                 }
 			}
         }
     }
     else {
-        BubbleVector list = getList(bubble);
+        const BubbleVector& list = getList(bubble);
         for (auto it = list.rbegin(); it != list.rend(); ++it) {
-            printBubble(*it, numbersOut);
+            printBubble<legacy>(*it, numbersOut, out);
         }
     }
 }
-
-// Add a helper function to log warnings
-void AwaInterpreter::logWarning(const std::string& message, unsigned int executionStep) {
-    totalWarnings++;
-    std::cerr << "[AwaInterpreter] " << "[" << std::setfill('0') << std::setw(4) << totalWarnings << "] " << message << " on step " << executionStep << "." << std::endl;
-}
@@ -1,4 +1,7 @@
 #pragma once
+#include "Warnings.hpp"
+#include "SmallVector.hpp"
+#include "BubbleArena.hpp"
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -10,15 +13,43 @@
 #include <optional>
 #include <sstream>
 #include <array>
+#include <memory>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
 
 struct Bubble;
-using BubbleVector = std::vector<Bubble>;
+struct BubbleList;
+using BubbleVector = SmallVector<Bubble, 4, ArenaAllocator<Bubble>>;     // Most double bubbles come from div or short groups
+
+/**
+* @brief A simple bubble holding an int, or a double bubble holding a list of bubbles.
+* @details The list of a double bubble is shared between its copies and only copied when one of them is changed,
+*   so duplicating, capturing or snapshotting a double bubble is O(1) regardless of its size.
+*   Lists of up to 4 bubbles live inside the shared block, a double bubble then takes a single allocation.
+*   The blocks come from the arena of the VM executing on this thread, see BubbleArena.
+*/
 struct Bubble {
-    std::variant<int, BubbleVector> value;
+    std::variant<int, std::shared_ptr<BubbleList>> value;
     Bubble(int i) : value(i) {}
-    Bubble(const BubbleVector& v) : value(v) {}
+    Bubble(const BubbleVector& v);
+    Bubble(BubbleVector&& v);
+};
+
+/**
+* @brief The shared list of a double bubble.
+* @details A list is not changed while it is shared, so the count of the bubbles in it is kept once counted.
+*/
+struct BubbleList : BubbleVector {
+    BubbleList(const BubbleVector& v) : BubbleVector(v) {}
+    BubbleList(BubbleVector&& v) : BubbleVector(std::move(v)) {}
+
+    mutable size_t count = 0;       // The list and the bubbles in it recursively, 0 until AwaInterpreter::countBubbles counted them
 };
 
+inline Bubble::Bubble(const BubbleVector& v) : value(std::allocate_shared<BubbleList>(ArenaAllocator<BubbleList>(), v)) {}
+inline Bubble::Bubble(BubbleVector&& v) : value(std::allocate_shared<BubbleList>(ArenaAllocator<BubbleList>(), std::move(v))) {}
+
 /**
 * @brief Checks if a Bubble object is a DoubleBubble (i.e. contains a BubbleVector) or a SimpleBubble (i.e. contains an int).
 * 
@@ -27,7 +58,7 @@ struct Bubble {
 * @return true if the Bubble is a DoubleBubble, false if it is a SimpleBubble.
 */
 static bool isDouble(const Bubble& bubble) {
-    return std::holds_alternative<BubbleVector>(bubble.value);
+    return std::holds_alternative<std::shared_ptr<BubbleList>>(bubble.value);
 }
 
 /**
@@ -50,16 +81,33 @@ static int getInt(const Bubble& bubble) {
 * 
 * @param bubble The Bubble object from which to retrieve the BubbleVector.
 * 
-* @return The BubbleVector contained in the Bubble if it is a DoubleBubble.
+* @return The BubbleVector contained in the Bubble if it is a DoubleBubble, shared with the copies of the Bubble.
 * @throws std::bad_variant_access if the Bubble does not contain a BubbleVector (i.e. is a SimpleBubble).
 */
-static BubbleVector getList(const Bubble& bubble) {
-    if (std::holds_alternative<BubbleVector>(bubble.value)) {
-        return std::get<BubbleVector>(bubble.value);
+static const BubbleList& getList(const Bubble& bubble) {
+    if (std::holds_alternative<std::shared_ptr<BubbleList>>(bubble.value)) {
+        return *std::get<std::shared_ptr<BubbleList>>(bubble.value);
     }
     throw std::bad_variant_access();
 }
 
+/**
+* @brief Retrieves the BubbleVector from a DoubleBubble for changing it, copying it first if other Bubbles share it.
+*
+* @param bubble The Bubble object from which to retrieve the BubbleVector.
+*
+* @return The BubbleVector contained in the Bubble, owned by it alone.
+* @throws std::bad_variant_access if the Bubble does not contain a BubbleVector (i.e. is a SimpleBubble).
+*/
+static BubbleVector& editList(Bubble& bubble) {
+    std::shared_ptr<BubbleList>& list = std::get<std::shared_ptr<BubbleList>>(bubble.value);
+    if (list.use_count() > 1) {
+        list = std::allocate_shared<BubbleList>(ArenaAllocator<BubbleList>(), *list);
+    }
+    list->count = 0;
+    return *list;
+}
+
 enum Awatisms {
     nop = 0,
     prn = 1,
@@ -86,65 +134,649 @@ enum Awatisms {
     trm = 31
 };
 
+/**
+* @brief Retrieves the Awably name of an instruction code.
+* 
+* @return The name, "undefined" for codes without an instruction.
+*/
+inline constexpr std::string_view awatismName(int code) {
+    constexpr std::string_view names[] = {
+        "nop", "prn", "pr1", "red", "r3d", "blw", "sbm", "pop", "dpl", "srn", "mrg",
+        "4dd", "sub", "mul", "div", "cnt", "lbl", "jmp", "eql", "lss", "gr8", "mov"
+    };
+
+    if (code >= 0 && code < static_cast<int>(std::size(names))) {
+        return names[code];
+    }
+    return (code == trm) ? "trm" : "undefined";
+}
+
+/**
+* @brief Appends a bubble the way the stacktrace writes it, double bubbles in parentheses.
+*/
+static void formatBubble(const Bubble& bubble, std::string& out) {
+    if (!isDouble(bubble)) {
+        out += std::to_string(std::get<int>(bubble.value));
+        return;
+    }
+
+    out += '(';
+    const BubbleVector& list = getList(bubble);
+    for (size_t i = 0; i < list.size(); i++) {
+        if (i > 0) out += ' ';
+        formatBubble(list[i], out);
+    }
+    out += ')';
+}
+
 struct StacktraceEntry {
-    unsigned int executionTime;
+    uint64_t executionTime;
     std::string instruction;
     std::vector<Bubble> stack;
     std::array<int, 16> registers;
 };
 
-class AwaInterpreter {
+/**
+* @brief Source of the input used by Read(`red`) and Read Num(`r3d`).
+*/
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+
+    /**
+    * @brief Retrieves the input visible to the current read.
+    *
+    * @return The input string, an empty view if there is no input.
+    */
+    virtual std::string_view read() = 0;
+
+    /**
+    * @brief Checks whether the input has arrived, a read on an input that is not ready parks the execution.
+    */
+    virtual bool ready() { return true; }
+};
+
+/**
+* @brief Destination of the output produced by Print(`prn`) and Print Num(`pr1`).
+*/
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(std::string_view text) = 0;
+};
+
+/**
+* @brief Input source over a fixed string, every read sees the whole string.
+*/
+class StringInput : public InputSource {
+public:
+    StringInput() = default;
+    explicit StringInput(std::string input) : input(std::move(input)) {}
+
+    void set(std::string newInput) { input = std::move(newInput); }
+    std::string_view read() override { return input; }
+
+private:
+    std::string input;
+};
+
+/**
+* @brief Output sink writing to a std::ostream.
+*/
+class StreamOutput : public OutputSink {
+public:
+    explicit StreamOutput(std::ostream& os) : os(os) {}
+    void write(std::string_view text) override { os.write(text.data(), static_cast<std::streamsize>(text.size())); }
+
+private:
+    std::ostream& os;
+};
+
+/**
+* @brief Output sink collecting everything into a string.
+*/
+class StringOutput : public OutputSink {
+public:
+    void write(std::string_view text) override { output.append(text); }
+
+    std::string output;
+};
+
+/**
+* @brief Incremental decoder turning a stream of Awalang bits into instructions and their parameters.
+* @details Which and how many parameters follow an instruction depends on the encoding and on the flag parameters of AWA5.0++.
+*   constexpr, so programs embedded in C++ can be decoded at compile time, see EmbeddedProgram.hpp.
+*/
+class AwatalkDecoder {
 public:
+    constexpr explicit AwatalkDecoder(bool legacy) : legacy(legacy) {}
+
     /**
-	* @brief Executes Awalang code and produces a stacktrace of the execution.
+    * @brief Feeds the next bit.
     * 
-	* @param code The Awalang code to be executed, represented as a string.
-	* @param input The input string to be used for instructions that require input (e.g. "red").
-	* @param isDebug Boolean flag indicating whether to generate debug information during execution.
+    * @param bit The bit, 0 or 1.
+    * @param value Receives the instruction or parameter the bit completes.
     * 
-	* @return A pair with a vector of stacktrace entries, and a boolean for whether the code is legacy or not.
+    * @return true if the bit completed a value.
+    */
+    constexpr bool push(int bit, int& value) {
+        if (bit) {
+            if (targetBit == 8 && bitCounter == 0 && signed_) {
+                newValue = -1;
+            }
+            else {
+                newValue = (newValue << 1) + 1;
+            }
+        }
+        else {
+            newValue <<= 1;
+        }
+        bitCounter++;
+
+        if (bitCounter < targetBit) {
+            return false;
+        }
+
+        value = newValue;
+        bitCounter = 0;
+
+        // For conditionals
+        if (previousValueDependent) {
+            previousValueDependent = false;
+
+            switch (previousInstruction) {
+            case blw:
+                signed_ = !newValue;
+                expect(newValue ? 4 : 8);
+                break;
+            case mov:
+                signed_ = !newValue;
+                expect(4);
+                expect(newValue ? 4 : 8);
+                break;
+            case sbm:
+            case srn:
+            case jmp:
+                signed_ = false;
+                expect(newValue ? 4 : 5);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (newInstruction) {
+            previousInstruction = newValue;
+
+            if (!legacy) {
+                switch (newValue) {
+                case blw:
+                case sbm:
+                case srn:
+                case jmp:
+                case mov:
+                    signed_ = false;
+                    expect(1);
+                    previousValueDependent = true;
+                    break;
+                case pop:
+                    signed_ = false;
+                    expect(4);
+                    break;
+                default:
+                    break;
+                }
+            }
+            else {
+                switch (newValue) {
+                case blw:
+                    signed_ = true;
+                    expect(8);
+                    break;
+                case sbm:
+                case srn:
+                case jmp:
+                case lbl:
+                    signed_ = false;
+                    expect(5);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        if (pendingCount == 0) {
+            targetBit = 5;
+            signed_ = false;
+            newInstruction = true;
+        }
+        else {
+            targetBit = pending[0];
+            pending[0] = pending[1];
+            pendingCount--;
+            newInstruction = false;
+        }
+
+        newValue = 0;
+        return true;
+    }
+
+    /**
+    * @brief Whether the bits so far end on an instruction boundary, not within an instruction or its parameters.
+    */
+    constexpr bool complete() const { return bitCounter == 0 && newInstruction; }
+
+    /**
+    * @brief Whether the bits being read form an instruction rather than a parameter.
     */
-    std::pair<std::vector<StacktraceEntry>, bool> run(const std::string& code, const std::string& input, const bool isDebug);
+    constexpr bool readingInstruction() const { return newInstruction; }
+
 private:
+    constexpr void expect(int bits) { pending[pendingCount++] = bits; }
+
+    bool legacy;
+    int bitCounter = 0;
+    int targetBit = 5;
+    int newValue = 0;
+    std::array<int, 2> pending{};           // Lengths of the parameters still to be read, mov has the most with 2
+    size_t pendingCount = 0;
+    bool signed_ = false;       // Rename due to collision with the "signed" keyword
+    bool newInstruction = true;
+
+    bool previousValueDependent = false;    // Would only be true if non-legacy
+    int previousInstruction = -1;
+};
+
+/**
+* @brief How decodeAwalang ended.
+*/
+struct AwalangScan {
+    bool header;                // false if neither header was found, nothing is decoded then
+    bool complete;              // false if the code ends within an instruction or its parameters
+};
+
+/**
+* @brief Decodes Awalang text, "wa" is a 1 bit, " awa" a 0 bit, anything else is skipped.
+*
+* @param awa The Awalang code, starting with the "awa" (legacy) or "awawa" (AWA5.0++) header.
+* @param legacy Set to whether the code has the legacy header or not.
+* @param emit Called with every decoded value and whether it is an instruction or a parameter, in order.
+*/
+template <typename Emit>
+constexpr AwalangScan decodeAwalang(std::string_view awa, bool& legacy, Emit&& emit) {
+    legacy = false;
+    if (awa.size() < 6) {
+        return { false, true };
+    }
+
+    size_t awaIndex = 0;
+    bool header = false;
+    for (; awaIndex < awa.size() - 6; awaIndex++) {
+        if (awa.substr(awaIndex, 6) == "awawa ") {
+            legacy = false;
+            header = true;
+            awaIndex += 5;
+            break;
+        }
+
+        if (awa.substr(awaIndex, 4) == "awa ") {
+            legacy = true;
+            header = true;
+            awaIndex += 3;
+            break;
+        }
+    }
+
+    AwatalkDecoder decoder(legacy);
+    if (awaIndex >= awa.size() - (legacy ? 3 : 5)) {
+        return { header, true };
+    }
+
+    int value = 0;
+    while (awaIndex < awa.size() - 1) {
+        int bit;
+        if (awa.compare(awaIndex, 2, "wa") == 0) {
+            bit = 1;
+            awaIndex += 2;
+        }
+        else if (awaIndex < awa.size() - 3 && awa.compare(awaIndex, 4, " awa") == 0) {
+            bit = 0;
+            awaIndex += 4;
+        }
+        else {
+            awaIndex++;
+            continue;
+        }
+
+        bool instruction = decoder.readingInstruction();
+        if (decoder.push(bit, value)) emit(value, instruction);
+    }
+
+    return { header, decoder.complete() };
+}
+
+/**
+* @brief Calls f(label, position) for every label of the instructions from start on, position is the index of the label parameter.
+* @details A label defined twice jumps to its last definition, as f is called for both in order.
+*/
+template <typename Data, typename F>
+constexpr void forEachLabel(const Data& data, size_t start, F&& f) {
+    for (size_t i = start; i < data.size(); i++) {
+        switch (data[i]) {
+        case lbl:
+            if (i + 1 < data.size()) f(data[i + 1], i + 1);
+            i++;
+            break;
+        case blw:
+        case sbm:
+        case srn:
+        case jmp:
+            i++;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+* @brief Returns how many slots a conditional skips when the instruction after it is op, see AwaInterpreter::skipNextInstruction.
+*/
+constexpr size_t skippedLength(int op) {
+    switch (op) {
+    case pop:
+    case lbl:
+    case jmp:
+        return 2;
+    case blw:
+    case sbm:
+    case srn:
+        return 3;
+    case mov:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+/**
+* @brief A loop the engine runs as one native operation when execution falls into its lbl, see LoopIdioms.
+*/
+struct LoopIdiom {
+    enum class Kind : uint8_t {
+        Countdown,      // Pushes the same bubbles under the counter every iteration
+        Rotation,       // Moves the bubble under the counter to the bottom every iteration
+        Accumulation    // Merges the bubble under the counter with the one below it every iteration
+    };
+
+    struct Push {
+        bool counter;   // Pushes the counter itself instead of value
+        int value;
+    };
+
+    Kind kind;
+    size_t exit;                    // The position the loop leaves to, the parameter of its exit lbl like in CompiledProgram::lblTable
+    uint64_t iterationSteps;        // Steps of one iteration, the final test takes 3 more
+    std::vector<Push> pushes;       // Countdown only, in the order of the body
+};
+
+/**
+* @brief A decoded Awalang program with its label table.
+* @details Never modified after AwaInterpreter::compile, so one instance can be shared by any number of threads.
+*   Only a program being streamed in by a Pipeline grows, on the thread executing it.
+*/
+struct CompiledProgram {
+    std::vector<int> data;
+    std::map<int, size_t> lblTable;
     bool legacy = false;
-    
+    bool complete = true;                       // false while more code is decoded, the labels are only known once it is
+    std::map<size_t, LoopIdiom> loops;          // Recognized by LoopIdioms::recognize, keyed by the position of their lbl
+};
+
+/**
+* @brief Limits on a single execution, 0 means unlimited.
+* @details Checked only on backward jumps and when bubbles are blown, so a run may overshoot the step limit by at most the length of the program.
+*/
+struct ExecutionLimits {
+    uint64_t maxSteps = 0;
+    size_t maxBubbles = 0;                      // Total bubbles in the abyss, bubbles inside double bubbles included
+    std::chrono::milliseconds timeout{ 0 };
+};
+
+/**
+* @brief The mutable state of one execution.
+* @details Reset between runs instead of being recreated, the containers keep their capacity.
+*   A copy gets an arena of its own, so it may run on another thread and outlive this state.
+*   The double bubbles in the abyss live in the arena, a Bubble copied out of the state must not outlive the arena.
+*/
+struct VmState {
+    using Registers = std::array<int, 16>;
+
+    VmState() = default;
+    /**
+    * @brief Copies the state with its double bubbles into a new arena, O(bubbles).
+    */
+    VmState(const VmState& other);
+    VmState& operator=(const VmState& other);
+    VmState(VmState&&) = default;
+    VmState& operator=(VmState&&) = default;
+
+    /**
+    * @brief Copies the state in O(1), sharing its arena and double bubbles.
+    * @details For snapshots kept and restored on the thread running the state, the arena is not thread safe.
+    */
+    VmState share() const;
+
+    std::shared_ptr<BubbleArena> arena = std::make_shared<BubbleArena>();   // Shared with share() copies, nullptr for the global heap
+
+    std::vector<Bubble> bubbleAbyss;
+    Registers bubblePond{};
+    size_t pc = 0;
+    uint64_t executionStep = 0;
+    bool terminated = false;
+
+    ExecutionLimits limits;
+    size_t bubbleCount = 0;                     // Only counted when limits.maxBubbles is set
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    unsigned int backwardJumps = 0;             // The clock is read on every 256th, counted across time slices
+
+    bool recordTrace = false;
+    std::vector<StacktraceEntry> stacktrace;
+
+    bool recordProfile = false;
+    std::array<uint64_t, 32> profile{};         // Executed steps per instruction code, only counted when recordProfile is set
+
+    /**
+    * @brief Returns the state to the start of a program without releasing its memory, the limits are kept and the timeout restarts.
+    */
+    void reset() {
+        bubbleAbyss.clear();
+        bubblePond.fill(0);
+        pc = 0;
+        executionStep = 0;
+        terminated = false;
+        bubbleCount = 0;
+        backwardJumps = 0;
+        stacktrace.clear();
+        profile.fill(0);
+        if (arena) arena->reset();
+        startTimeout();
+    }
+
+    /**
+    * @brief Sets the limits of the execution and starts its timeout.
+    */
+    void setLimits(const ExecutionLimits& newLimits) {
+        limits = newLimits;
+        startTimeout();
+    }
+
+    void startTimeout() {
+        deadline = (limits.timeout.count() > 0) ? std::chrono::steady_clock::now() + limits.timeout : std::chrono::steady_clock::time_point::max();
+    }
+
+private:
+    explicit VmState(std::shared_ptr<BubbleArena> arena) : arena(std::move(arena)) {}
+
+    /**
+    * @brief Copies everything but the arena, the abyss and the stacktrace.
+    */
+    void copyScalars(const VmState& other);
+};
+
+/**
+* @brief The reason AwaInterpreter::execute returned.
+*/
+enum class ExecuteStatus {
+    Finished,           // Ran past the last instruction
+    Terminated,         // Executed Terminate(`trm`)
+    Yielded,            // Used up its time slice, execute again to continue
+    WaitingForInput,    // Read on an input that is not ready, execute again once it is
+    StepLimit,          // Exceeded ExecutionLimits::maxSteps
+    MemoryLimit,        // Exceeded ExecutionLimits::maxBubbles
+    Timeout,            // Exceeded ExecutionLimits::timeout
+    WaitingForCode      // Reached a jmp or the end of a program that is still being decoded, execute again once more is decoded
+};
+
+/**
+* @brief Describes an ExecuteStatus.
+*/
+const char* describe(ExecuteStatus status);
+
+/**
+* @brief The result of AwaInterpreter::run.
+*/
+struct RunResult {
+    std::shared_ptr<BubbleArena> arena;         // Holds the bubbles of the stacktrace
+    std::vector<StacktraceEntry> stacktrace;
+    bool legacy;
+    ExecuteStatus status;
+    uint64_t steps;
+};
+
+/**
+* @brief The sinks a VmState reads from and writes to.
+*/
+struct VmIo {
+    InputSource& input;
+    OutputSink& output;
+    WarningSink& warnings;
+};
+
+class AwaInterpreter {
+public:
     /**
-	* @brief Converts Awalang code into a vector of integers representing instructions and their parameters.
+    * @brief Executes Awalang code and produces a stacktrace of the execution.
     * 
-	* @param awa The Awalang code to be converted.
+    * @param code The Awalang code to be executed, represented as a string.
+    * @param input The input string to be used for instructions that require input (e.g. "red").
+    * @param isDebug Boolean flag indicating whether to generate debug information during execution.
+    * @param limits The limits of the execution.
+    * @param warnings The sink receiving the warnings, a StreamWarningSink on std::cerr if not given.
     * 
-	* @return A vector of integers, representing the sequence of instructions and parameters in bytecodes.
+    * @return The stacktrace, whether the code is legacy or not, and how the execution ended.
     */
-    std::vector<int> ReadAwatalk(const std::string& awaBlock);
+    RunResult run(const std::string& code, const std::string& input, const bool isDebug, const ExecutionLimits& limits = {}, WarningSink* warnings = nullptr);
 
     /**
-	* @brief Executes the instructions stored in the data vector, where the switch-case structure is located to handle each instruction's behavior.
+    * @brief Executes a compiled program and produces a stacktrace of the execution.
+    * @details Same as above, for programs compiled by compile or compileAwably.
+    */
+    RunResult run(std::shared_ptr<const CompiledProgram> program, const std::string& input, const bool isDebug, const ExecutionLimits& limits = {}, WarningSink* warnings = nullptr);
+
+    /**
+    * @brief Decodes Awalang code and builds its label table.
+    * 
+    * @param code The Awalang code to be compiled.
     * 
-	* @param input The input string to be used for instructions that require input (e.g. "red").
+    * @return The compiled program, immutable and shareable between threads.
     */
-    void executeInstructions(const std::string& input);
-    void skipNextInstruction(size_t& i);
-    void buildLabelTable();
+    static std::shared_ptr<const CompiledProgram> compile(const std::string& code);
 
-    Bubble addBubbles(const Bubble& a, const Bubble& b);
-    Bubble subBubbles(const Bubble& a, const Bubble& b);
-    Bubble mulBubbles(const Bubble& a, const Bubble& b);
-    Bubble divBubbles(const Bubble& a, const Bubble& b);
-    void printBubble(const Bubble& bubble, bool numbersOut);
+    /**
+    * @brief Compiles Awably code straight into a program, without generating the Awalang text in between.
+    * @details Follows Awabler::legacy and reports to Awabler::warnings, the program is the same as compile(Awabler::convertCode(code)).
+    * 
+    * @param code The Awably code to be compiled.
+    * 
+    * @return The compiled program, immutable and shareable between threads.
+    */
+    static std::shared_ptr<const CompiledProgram> compileAwably(const std::string& code);
 
     /**
-	* @brief Logs a warning message.
+    * @brief Same as above, with the Awabler settings given instead of taken from Awabler, so any number of threads may compile at once.
     * 
-	* @param message The warning message to be logged.
-	* @param executionStep The current execution step or instruction pointer.
+    * @param code The Awably code to be compiled.
+    * @param legacy Whether to compile to legacy Awalang.
+    * @param warnings The sink receiving the warnings.
     */
-    void logWarning(const std::string& message, unsigned int executionStep);
+    static std::shared_ptr<const CompiledProgram> compileAwably(const std::string& code, bool legacy, WarningSink& warnings);
 
-    std::array<int, 16> bubblePond{};
-    std::vector<Bubble> bubbleAbyss;
-    std::map<int, size_t> lblTable;
-    std::vector<int> data;
-    unsigned int totalWarnings = 0;
-    std::vector<StacktraceEntry> stacktrace;
-    const std::string AwaSCII = "AWawJELYHOSIUMjelyhosiumPCNTpcntBDFGRbdfgr0123456789 .,!'()~_/;\n";
+    /**
+    * @brief Appends Awably code to a program, only the new code is parsed and scanned for labels.
+    * @details Follows the encoding of the program and reports to Awabler::warnings.
+    *   A program must not be appended to while it is shared with other threads.
+    * 
+    * @param program The program to be extended.
+    * @param code The Awably code to be appended.
+    */
+    static void appendAwably(CompiledProgram& program, const std::string& code);
+
+    /**
+    * @brief Same as above, reporting to the given sink.
+    */
+    static void appendAwably(CompiledProgram& program, const std::string& code, WarningSink& warnings);
+
+    /**
+    * @brief Executes a compiled program from the current position of the state until it ends, terminates or yields.
+    * 
+    * @param program The program to be executed.
+    * @param state The state to execute on, call VmState::reset before reusing it for a new run.
+    * @param io The input, output and warning sinks of the execution.
+    * @param sliceSteps The number of steps to execute before yielding, 0 to never yield.
+    * 
+    * @return Why the execution returned.
+    */
+    static ExecuteStatus execute(const CompiledProgram& program, VmState& state, const VmIo& io, unsigned int sliceSteps = 0);
+
+private:
+    /**
+    * @brief The execution engine of one dialect, every dialect check in it is resolved at compile time.
+    */
+    template <bool legacy>
+    static ExecuteStatus executeDialect(const CompiledProgram& program, VmState& state, const VmIo& io, unsigned int sliceSteps);
+
+    /**
+    * @brief Converts Awalang code into a vector of integers representing instructions and their parameters.
+    * 
+    * @param awa The Awalang code to be converted.
+    * @param legacy Set to whether the code has the legacy header or not.
+    * 
+    * @return A vector of integers, representing the sequence of instructions and parameters in bytecodes.
+    */
+    static std::vector<int> ReadAwatalk(const std::string& awaBlock, bool& legacy);
+
+    /**
+    * @brief Parses the first token of the input starting with a number like r3d does, 0 if there is none.
+    */
+    static int readNumber(std::string_view input);
+
+    static void skipNextInstruction(const std::vector<int>& data, size_t& i);
+    static std::map<int, size_t> buildLabelTable(const std::vector<int>& data);
+    static void addLabels(const std::vector<int>& data, size_t start, std::map<int, size_t>& lblTable);
+
+    static Bubble addBubbles(const Bubble& a, const Bubble& b);
+    static Bubble subBubbles(const Bubble& a, const Bubble& b);
+    static Bubble mulBubbles(const Bubble& a, const Bubble& b);
+    static Bubble divBubbles(const Bubble& a, const Bubble& b);
+    static Bubble mergeBubbles(Bubble bubble1, Bubble bubble2);
+    static size_t countBubbles(const Bubble& bubble);
+    template <bool legacy>
+    static void printBubble(const Bubble& bubble, bool numbersOut, std::string& out);
+
+    static constexpr std::string_view AwaSCII = "AWawJELYHOSIUMjelyhosiumPCNTpcntBDFGRbdfgr0123456789 .,!'()~_/;\n";
+
+    friend class LoopIdioms;
+    friend class LockstepRunner;
 };
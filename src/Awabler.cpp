@@ -1,10 +1,21 @@
 #include "Awabler.hpp"
+#include <thread>
+#include <atomic>
+
+static StreamWarningSink defaultWarnings;
 
 bool Awabler::verbose = false;
 bool Awabler::legacy = false;
-static int totalWarnings = 0;
+WarningSink* Awabler::warnings = &defaultWarnings;
+
+namespace {
 
-std::string Awabler::convertAwatalk(int number, int length) {
+/**
+* @brief Encodes the lowest length bits of a number into Awalang.
+*
+* @remark Only used to fill the Awatalk table, see Awabler::convertAwatalk.
+*/
+std::string encodeAwatalk(int number, int length) {
     number = number & ((1 << length) - 1);
     std::string binStr;
     for (int i = length - 1; i >= 0; i--) {
@@ -22,167 +33,187 @@ std::string Awabler::convertAwatalk(int number, int length) {
     return binStr;
 }
 
-int Awabler::convertAwatism(const std::string& instruction) {
-    static const std::vector<std::string> lookup = {
-        "nop", "prn", "pr1", "red", "r3d", "blw", "sbm", "pop", "dpl", "srn", "mrg",
-        "4dd", "sub", "mul", "div", "cnt", "lbl", "jmp", "eql", "lss", "gr8", "trm"
-    };
+/**
+* @brief The Awalang encoding of every value of every parameter length, indexed by [length][value].
+*/
+struct AwatalkTable {
+    std::array<std::vector<std::string>, 9> encodings;
 
-    auto it = std::find(lookup.begin(), lookup.end(), instruction);
-    if (it == lookup.end()) {
-        totalWarnings++;
-        std::cerr << "[Awabler] " << "[" << std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Instruction \"" << instruction << "\" undefined." << std::endl;
-        return -1;
+    AwatalkTable() {
+        for (int length = 1; length <= 8; length++) {
+            encodings[length].reserve(static_cast<size_t>(1) << length);
+            for (int value = 0; value < (1 << length); value++) {
+                encodings[length].push_back(encodeAwatalk(value, length));
+            }
+        }
     }
+};
 
-    int index = static_cast<int>(std::distance(lookup.begin(), it));
+const AwatalkTable awatalkTable;
 
-    return (index == 21) ? 31 : index;
 }
 
-int Awabler::convertAwaSCII(std::string& byte) {
-    if (Awabler::legacy) {
-        static const std::vector<std::string> lookup = {
-            "A", "W", "a", "w", "J", "E", "L", "Y", "H", "O",
-            "S", "I", "U", "M", "j", "e", "l", "y", "h", "o",
-            "s", "i", "u", "m", "P", "C", "N", "T", "p", "c",
-            "n", "t", "B", "D", "F", "G", "R", "b", "d", "f",
-            "g", "r", "0", "1", "2", "3", "4", "5", "6", "7",
-            "8", "9", "space", ".", ",", "!", "'", "(", ")", "~",
-            "_", "/", ";", "\\n"
-        };
+void Awabler::warn(WarningSink& sink, WarningCode code, size_t lineNumber, std::string detail) {
+    sink.warn({ WarningSource::Awabler, code, 0, lineNumber, 0, std::move(detail) });
+}
 
-        auto it = std::find(lookup.begin(), lookup.end(), byte);
-        if (it == lookup.end()) {
-            totalWarnings++;
-            std::cerr << "[Awabler] " << "[" << std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Token \"" << byte << "\" is not found in the AwaSCII table." << std::endl;
-            return -1;
-        }
+const std::string& Awabler::convertAwatalk(int number, int length) {
+    return awatalkTable.encodings[length][number & ((1 << length) - 1)];
+}
 
-        return static_cast<int>(std::distance(lookup.begin(), it));
+int Awabler::convertAwatism(std::string_view instruction, size_t lineNumber, WarningSink& sink) {
+    int code = awatismCode(instruction);
+    if (code < 0) {
+        warn(sink, WarningCode::UndefinedInstruction, lineNumber, "Instruction \"" + std::string(instruction) + "\" undefined");
     }
-    else {
-        if (byte == "space") {
-            return 32;
-        }
-        else if (byte == "\\t") {
-            return 9;
-        }
-        else if (byte == "\\n") {
-            return 10; 
-        }
-        else if (byte == "\\r") {
-            return 13;
-        }
-        else if (byte.length() != 1) {
-            totalWarnings++;
-            std::cerr << "[Awabler] [" << std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Token \"" << byte << "\" is not a single character and is not recognized as a special token (space or \\n)." << std::endl;
-            return -1;
-        }
+    return code;
+}
 
-        unsigned char c = static_cast<unsigned char>(byte[0]);
-        if (c > 127 || c < 0) {
-            totalWarnings++;
-            std::cerr << "[Awabler] [" << std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Character \"" << byte << "\" is outside the valid ASCII range (0-127)." << std::endl;
-            return -1;
-        }
+int Awabler::convertAwaSCII(std::string_view byte, bool legacy, size_t lineNumber, WarningSink& sink) {
+    int code = awaSCIICode(byte, legacy);
+    if (code >= 0) {
+        return code;
+    }
 
-        return static_cast<int>(c);
+    if (legacy) {
+        warn(sink, WarningCode::UndefinedToken, lineNumber, "Token \"" + std::string(byte) + "\" is not found in the AwaSCII table");
+    }
+    else if (byte.length() != 1) {
+        warn(sink, WarningCode::UndefinedToken, lineNumber, "Token \"" + std::string(byte) + "\" is not a single character and is not recognized as a special token (space or \\n)");
     }
+    else {
+        warn(sink, WarningCode::UndefinedToken, lineNumber, "Character \"" + std::string(byte) + "\" is outside the valid ASCII range (0-127)");
+    }
+    return -1;
 }
 
-Awabler::LineResult Awabler::convertLine(const std::string& line) {
-    static const std::vector<std::string> s8 = {"blw"};
-    static const std::vector<std::string> u5 = {"sbm", "srn", "lbl", "jmp"};
-
-    std::string trimmed = line;
-    strip(trimmed);
+Awabler::LineResult Awabler::convertLine(std::string_view line, bool legacy, size_t lineNumber, WarningSink& sink) {
+    std::string_view trimmed = trim(line);
     if (trimmed.empty()) {
-        return {"", -1, std::nullopt};
+        return {false, -1, std::nullopt, 0};
 	}
 
     size_t pos = trimmed.find(' ');
-    if (pos == std::string::npos) {
-        if (std::find(s8.begin(), s8.end(), trimmed) != s8.end() ||
-            std::find(u5.begin(), u5.end(), trimmed) != u5.end()) {
-            totalWarnings++;
-            std::cerr << "[Awabler] " << "[" <<  std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Instruction \"" << trimmed << "\" requires a parameter." << std::endl;
-            return {"", -1, std::nullopt};
+    if (pos == std::string_view::npos) {
+        if (parameterLength(trimmed)) {
+            warn(sink, WarningCode::MissingParameter, lineNumber, "Instruction \"" + std::string(trimmed) + "\" requires a parameter");
+            return {false, -1, std::nullopt, 0};
         }
 
-        int instrCode = convertAwatism(trimmed);
-
-        return {convertAwatalk(instrCode, 5), instrCode, std::nullopt};
+        return {true, convertAwatism(trimmed, lineNumber, sink), std::nullopt, 0};
     }
 
-    std::string instruction = trimmed.substr(0, pos);
-    std::string paramStr = trimmed.substr(pos + 1);
-    strip(paramStr);
+    std::string_view instruction = trimmed.substr(0, pos);
+    std::string_view paramStr = trim(trimmed.substr(pos + 1));
 
-    if (std::find(s8.begin(), s8.end(), instruction) == s8.end() &&
-        std::find(u5.begin(), u5.end(), instruction) == u5.end()) {
-        totalWarnings++;
-        std::cerr << "[Awabler] " << "[" <<  std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Instruction \"" << instruction << "\" does not require the argument \"" << paramStr << "\"." << std::endl;
-        return {"", -1, std::nullopt};
+    int paramLength = parameterLength(instruction);
+    if (!paramLength) {
+        warn(sink, WarningCode::UnexpectedParameter, lineNumber, "Instruction \"" + std::string(instruction) + "\" does not require the argument \"" + std::string(paramStr) + "\"");
+        return {false, -1, std::nullopt, 0};
     }
 
     int parameter;
     if (paramStr.size() >= 3 && paramStr.substr(0, 2) == "S(" && paramStr.back() == ')') {
-        std::string inner = paramStr.substr(2, paramStr.size() - 3);
-        parameter = convertAwaSCII(inner);
+        parameter = convertAwaSCII(paramStr.substr(2, paramStr.size() - 3), legacy, lineNumber, sink);
     }
-    else {
-        try {
-            parameter = std::stoi(paramStr);
-        }
-        catch (...) {
-            totalWarnings++;
-            std::cerr << "[Awabler] " << "[" <<  std::setfill('0') << std::setw(4) << totalWarnings << "] Warning: Invalid parameter: \"" << paramStr << "\"." << std::endl;
-            return {"", -1, std::nullopt};
-        }
+    else if (!parseInt(paramStr, parameter)) {
+        warn(sink, WarningCode::InvalidParameter, lineNumber, "Invalid parameter: \"" + std::string(paramStr) + "\"");
+        return {false, -1, std::nullopt, 0};
     }
 
-    int instrCode = convertAwatism(instruction);
-    int paramLength = (std::find(u5.begin(), u5.end(), instruction) != u5.end()) ? 5 : 8;
-    std::string convInstr = convertAwatalk(instrCode, 5);
-    std::string convParam = convertAwatalk(parameter, paramLength);
+    return {true, convertAwatism(instruction, lineNumber, sink), parameter, paramLength};
+}
 
-    return {convInstr + " " + convParam, instrCode, parameter};
+void Awabler::appendLine(const LineResult& result, std::string& out) {
+    size_t size = out.size();
+    out.resize(size + lineLength(result));
+    writeLine(result, out.data() + size);
 }
 
-std::string Awabler::convertCode(std::string& code) {
-	if (!Awabler::legacy) totalWarnings++;
-    replace(code, ";", "\n");
+size_t Awabler::lineLength(const LineResult& result) {
+    if (!result.valid) {
+        return 0;
+    }
 
-    std::istringstream iss(code);
-    std::vector<std::string> originalLines;
-    std::string line;
-    while (std::getline(iss, line)) {
-        strip(line);
+    size_t length = 1 + convertAwatalk(result.instructionCode, 5).size();
+    if (result.parameter) {
+        length += 1 + convertAwatalk(*result.parameter, result.parameterLength).size();
+    }
+    return length;
+}
+
+char* Awabler::writeLine(const LineResult& result, char* out) {
+    if (!result.valid) {
+        return out;
+    }
 
-        if (!line.empty()) originalLines.push_back(line);
+    const std::string& instruction = convertAwatalk(result.instructionCode, 5);
+    *out++ = ' ';
+    out = std::copy(instruction.begin(), instruction.end(), out);
+    if (result.parameter) {
+        const std::string& parameter = convertAwatalk(*result.parameter, result.parameterLength);
+        *out++ = ' ';
+        out = std::copy(parameter.begin(), parameter.end(), out);
     }
+    return out;
+}
 
-    std::vector<LineResult> results;
-    for (const auto& ln : originalLines) {
-        results.push_back(convertLine(ln));
+std::string Awabler::convertCode(const std::string& code, unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
     }
 
-    std::vector<std::string> parts = {Awabler::legacy ? "awa" : "awawa"};
-    for (const auto& res : results) {
-        if (!res.converted.empty())
-            parts.push_back(res.converted);
+    if (verbose || threadCount == 1 || code.size() < parallelThreshold) {
+        return convertSerial(code);
     }
-    std::string convertedCode = join(parts, " ");
+    return convertParallel(code, threadCount);
+}
+
+std::vector<Awabler::LineResult> Awabler::parseCode(const std::string& code, bool legacy, WarningSink& sink) {
+    std::vector<LineResult> lines;
+    lines.reserve(1 + std::count_if(code.begin(), code.end(), [](char c) { return c == ';' || c == '\n'; }));
+
+    size_t lineNumber = 0;
+    forEachLine(code, [&](std::string_view line) {
+        LineResult result = convertLine(line, legacy, ++lineNumber, sink);
+        if (result.valid) lines.push_back(result);
+    });
+
+    return lines;
+}
+
+std::string Awabler::convertSerial(const std::string& code) {
+    // The longest line is 13 bits of "awa " plus a separator
+    size_t lineCount = 1 + std::count_if(code.begin(), code.end(), [](char c) { return c == ';' || c == '\n'; });
+    std::string convertedCode;
+    convertedCode.reserve(5 + lineCount * 53);
+    convertedCode = Awabler::legacy ? "awa" : "awawa";
+
+    struct VerboseLine {
+        std::string_view line;
+        LineResult result;
+        size_t begin, end;
+    };
+    std::vector<VerboseLine> verboseLines;
+
+    size_t lineNumber = 0;
+    forEachLine(code, [&](std::string_view line) {
+        LineResult result = convertLine(line, legacy, ++lineNumber, *warnings);
+        size_t begin = convertedCode.size();
+        appendLine(result, convertedCode);
+
+        if (verbose) verboseLines.push_back({ line, result, begin, convertedCode.size() });
+    });
 
     if (verbose) {
-        for (size_t i = 0; i < originalLines.size(); i++) {
-            std::string param = results[i].parameter.has_value()
-                ? std::to_string(results[i].parameter.value())
+        for (const VerboseLine& v : verboseLines) {
+            std::string converted = (v.end > v.begin) ? convertedCode.substr(v.begin + 1, v.end - v.begin - 1) : "";
+            std::string param = v.result.parameter.has_value()
+                ? std::to_string(v.result.parameter.value())
                 : "None";
-            std::cout << std::left << std::setw(20) << originalLines[i]
-                << std::setw(50) << results[i].converted
-                << std::setw(5) << results[i].instructionCode
+            std::cout << std::left << std::setw(20) << v.line
+                << std::setw(50) << converted
+                << std::setw(5) << (v.result.valid ? v.result.instructionCode : -1)
                 << " " << param << std::endl;
         }
 
@@ -190,4 +221,104 @@ std::string Awabler::convertCode(std::string& code) {
     }
 
     return convertedCode;
-}
\ No newline at end of file
+}
+
+std::string Awabler::convertParallel(const std::string& code, unsigned int threadCount) {
+    // Dropped lines are not kept, parameters are masked to their length like convertAwatalk does
+    auto pack = [](const LineResult& result) -> uint16_t {
+        uint16_t packed = static_cast<uint16_t>(result.instructionCode & 0x1F);
+        if (result.parameter) {
+            packed |= 0x20 | ((result.parameterLength == 5) ? 0x40 : 0) | ((*result.parameter & 0xFF) << 8);
+        }
+        return packed;
+    };
+    auto unpack = [](uint16_t packed) -> LineResult {
+        if (!(packed & 0x20)) {
+            return { true, packed & 0x1F, std::nullopt, 0 };
+        }
+        return { true, packed & 0x1F, packed >> 8, (packed & 0x40) ? 5 : 8 };
+    };
+
+    struct Chunk {
+        std::string_view code;
+        std::vector<uint16_t> results;
+        size_t lines = 0;
+        size_t length = 0;
+        size_t firstLine = 0;
+        size_t offset = 0;
+        WarningLog warnings{ true };
+    };
+
+    // Split into a few chunks per thread, each ending right after a separator
+    const std::string_view source(code);
+    const size_t chunkCount = static_cast<size_t>(threadCount) * 4;
+    const size_t targetSize = source.size() / chunkCount + 1;
+    std::vector<Chunk> chunks;
+    chunks.reserve(chunkCount + 1);
+    for (size_t begin = 0; begin < source.size();) {
+        size_t end = std::min(begin + targetSize, source.size());
+        if (end < source.size()) {
+            end = source.find_first_of(";\n", end);
+            end = (end == std::string_view::npos) ? source.size() : end + 1;
+        }
+        chunks.emplace_back().code = source.substr(begin, end - begin);
+        begin = end;
+    }
+
+    auto forEachChunk = [&](auto&& f) {
+        std::atomic<size_t> next{ 0 };
+        auto work = [&]() {
+            for (size_t c = next++; c < chunks.size(); c = next++) {
+                f(chunks[c]);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threadCount; t++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    };
+
+    // Parse and measure every chunk, warnings are kept with chunk-local line numbers
+    forEachChunk([&](Chunk& chunk) {
+        chunk.results.reserve(chunk.code.size() / 4);
+        forEachLine(chunk.code, [&](std::string_view line) {
+            LineResult result = convertLine(line, legacy, ++chunk.lines, chunk.warnings);
+            if (result.valid) {
+                chunk.length += lineLength(result);
+                chunk.results.push_back(pack(result));
+            }
+        });
+    });
+
+    std::string convertedCode = Awabler::legacy ? "awa" : "awawa";
+    size_t offset = convertedCode.size();
+    size_t lineNumber = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.offset = offset;
+        chunk.firstLine = lineNumber;
+        offset += chunk.length;
+        lineNumber += chunk.lines;
+
+        for (Warning warning : chunk.warnings.records) {
+            warning.pc += chunk.firstLine;
+            warnings->warn(warning);
+        }
+    }
+
+    // Write every chunk straight to its final offset
+    convertedCode.resize(offset);
+    forEachChunk([&](Chunk& chunk) {
+        char* out = convertedCode.data() + chunk.offset;
+        for (uint16_t packed : chunk.results) {
+            out = writeLine(unpack(packed), out);
+        }
+        chunk.results = {};
+    });
+
+    return convertedCode;
+}
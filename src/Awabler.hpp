@@ -1,4 +1,5 @@
 #pragma once
+#include "Warnings.hpp"
 #include <vector>
 #include <string>
 #include <sstream>
@@ -9,6 +10,9 @@
 #include <stdexcept>
 #include <cstdlib>
 #include <optional>
+#include <string_view>
+#include <array>
+#include <cstdint>
 
 /**
 * @brief Replaces all occurrences of a substring in a string with another substring.
@@ -69,17 +73,204 @@ class Awabler {
 public:
     static bool verbose;
     static bool legacy;
-    static std::string convertCode(std::string& code);
+    static WarningSink* warnings;              // Receives the warnings, a StreamWarningSink on std::cerr by default
+
+    /**
+    * @brief Transpiles Awably into Awalang.
+    * @details Inputs of at least parallelThreshold bytes are split into chunks at line boundaries and converted on several threads,
+    *   every chunk is written straight to its final offset in the output. Warnings are reported in source order either way.
+    * 
+    * @param code The Awably code, lines are separated by newlines or semicolons.
+    * @param threadCount The number of threads to convert on, 0 for one per hardware thread.
+    * 
+    * @return The Awalang code.
+    */
+    static std::string convertCode(const std::string& code, unsigned int threadCount = 1);
+
+    static constexpr size_t parallelThreshold = 1 << 20;
 
-private:
     struct LineResult {
-        std::string converted;
+        bool valid;                             // false if the line is dropped with a warning
         int instructionCode;
         std::optional<int> parameter;
+        int parameterLength;                    // In bits, 0 if the instruction takes no parameter
     };
-    
-    static std::string convertAwatalk(int number, int length = 8);
-    static int convertAwatism(const std::string& instruction);
-    static int convertAwaSCII(std::string& byte);
-    static LineResult convertLine(const std::string& line);
-};
+
+    /**
+    * @brief Parses Awably into the lines convertCode would encode, in order and without the dropped lines.
+    * 
+    * @param code The Awably code, lines are separated by newlines or semicolons.
+    * @param legacy Whether the strings are encoded in legacy AwaSCII, like Awabler::legacy does for convertCode.
+    * @param sink Receives the warnings.
+    * 
+    * @return The parsed lines, the values are not yet masked to their width.
+    */
+    static std::vector<LineResult> parseCode(const std::string& code, bool legacy, WarningSink& sink);
+
+    // The lexing is constexpr, so EmbeddedProgram.hpp can assemble Awably at compile time exactly like convertCode
+
+    /**
+    * @brief Packs a three character token into an integer, so tokens can be matched with a switch.
+    *
+    * @return The packed token, 0 if the token is not three characters long.
+    */
+    static constexpr uint32_t pack(std::string_view token) {
+        if (token.size() != 3) return 0;
+        return (static_cast<uint32_t>(static_cast<unsigned char>(token[0])) << 16) |
+            (static_cast<uint32_t>(static_cast<unsigned char>(token[1])) << 8) |
+            static_cast<uint32_t>(static_cast<unsigned char>(token[2]));
+    }
+
+    /**
+    * @brief Returns the code of an instruction, -1 if it is undefined.
+    */
+    static constexpr int awatismCode(std::string_view instruction) {
+        switch (pack(instruction)) {
+        case pack("nop"): return 0;
+        case pack("prn"): return 1;
+        case pack("pr1"): return 2;
+        case pack("red"): return 3;
+        case pack("r3d"): return 4;
+        case pack("blw"): return 5;
+        case pack("sbm"): return 6;
+        case pack("pop"): return 7;
+        case pack("dpl"): return 8;
+        case pack("srn"): return 9;
+        case pack("mrg"): return 10;
+        case pack("4dd"): return 11;
+        case pack("sub"): return 12;
+        case pack("mul"): return 13;
+        case pack("div"): return 14;
+        case pack("cnt"): return 15;
+        case pack("lbl"): return 16;
+        case pack("jmp"): return 17;
+        case pack("eql"): return 18;
+        case pack("lss"): return 19;
+        case pack("gr8"): return 20;
+        case pack("trm"): return 31;
+        default: return -1;
+        }
+    }
+
+    /**
+    * @brief Returns the parameter length of an instruction in bits, 0 if it takes no parameter.
+    */
+    static constexpr int parameterLength(std::string_view instruction) {
+        switch (pack(instruction)) {
+        case pack("blw"):
+            return 8;
+        case pack("sbm"):
+        case pack("srn"):
+        case pack("lbl"):
+        case pack("jmp"):
+            return 5;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+    * @brief Returns the value of the token inside S(...), -1 if the token is undefined.
+    * @details Legacy tokens are AwaSCII indices, AWA5.0++ tokens are ASCII codes. Space and newline are only accepted
+    *   as the "space" and "\n" tokens.
+    */
+    static constexpr int awaSCIICode(std::string_view byte, bool legacy) {
+        if (legacy) {
+            if (byte.size() == 1 && awaSCIIIndex[static_cast<unsigned char>(byte[0])] >= 0) {
+                return awaSCIIIndex[static_cast<unsigned char>(byte[0])];
+            }
+            if (byte == "space") return 52;
+            if (byte == "\\n") return 63;
+            return -1;
+        }
+
+        if (byte == "space") return 32;
+        if (byte == "\\t") return 9;
+        if (byte == "\\n") return 10;
+        if (byte == "\\r") return 13;
+        if (byte.size() != 1 || static_cast<unsigned char>(byte[0]) > 127) return -1;
+        return static_cast<int>(static_cast<unsigned char>(byte[0]));
+    }
+
+    /**
+    * @brief std::isspace in the "C" locale.
+    */
+    static constexpr bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    static constexpr std::string_view trim(std::string_view s) {
+        size_t begin = 0, end = s.size();
+        while (begin < end && isSpace(s[begin])) begin++;
+        while (end > begin && isSpace(s[end - 1])) end--;
+        return s.substr(begin, end - begin);
+    }
+
+    /**
+    * @brief Calls f with every trimmed, non-empty line of the code, lines are separated by newlines or semicolons.
+    */
+    template <typename F>
+    static constexpr void forEachLine(std::string_view code, F&& f) {
+        size_t start = 0;
+        while (start <= code.size()) {
+            size_t end = code.find_first_of(";\n", start);
+            if (end == std::string_view::npos) end = code.size();
+
+            std::string_view line = trim(code.substr(start, end - start));
+            start = end + 1;
+            if (!line.empty()) f(line);
+        }
+    }
+
+    /**
+    * @brief Parses an integer the way std::stoi does, trailing characters are ignored.
+    * 
+    * @return false if there are no digits or the value does not fit an int.
+    */
+    static constexpr bool parseInt(std::string_view s, int& value) {
+        size_t pos = 0;
+        if (pos < s.size() && s[pos] == '+' && pos + 1 < s.size() && s[pos + 1] != '-') pos++;
+
+        bool negative = pos < s.size() && s[pos] == '-';
+        if (negative) pos++;
+        if (pos >= s.size() || s[pos] < '0' || s[pos] > '9') return false;
+
+        int64_t magnitude = 0;
+        for (; pos < s.size() && s[pos] >= '0' && s[pos] <= '9'; pos++) {
+            magnitude = magnitude * 10 + (s[pos] - '0');
+            if (magnitude > int64_t(INT32_MAX) + 1) return false;
+        }
+        if (!negative && magnitude > INT32_MAX) return false;
+
+        value = static_cast<int>(negative ? -magnitude : magnitude);
+        return true;
+    }
+
+private:
+    /**
+    * @brief Maps single characters to their AwaSCII index, -1 for characters not in the table or only accepted as tokens.
+    */
+    static constexpr std::array<int, 256> awaSCIIIndex = [] {
+        std::array<int, 256> index{};
+        index.fill(-1);
+        constexpr std::string_view AwaSCII = "AWawJELYHOSIUMjelyhosiumPCNTpcntBDFGRbdfgr0123456789 .,!'()~_/;\n";
+        for (size_t i = 0; i < AwaSCII.size(); i++) {
+            if (AwaSCII[i] != ' ' && AwaSCII[i] != '\n') {
+                index[static_cast<unsigned char>(AwaSCII[i])] = static_cast<int>(i);
+            }
+        }
+        return index;
+    }();
+
+
+    static const std::string& convertAwatalk(int number, int length = 8);
+    static int convertAwatism(std::string_view instruction, size_t lineNumber, WarningSink& sink);
+    static int convertAwaSCII(std::string_view byte, bool legacy, size_t lineNumber, WarningSink& sink);
+    static LineResult convertLine(std::string_view line, bool legacy, size_t lineNumber, WarningSink& sink);
+    static void appendLine(const LineResult& result, std::string& out);
+    static size_t lineLength(const LineResult& result);
+    static char* writeLine(const LineResult& result, char* out);
+    static std::string convertSerial(const std::string& code);
+    static std::string convertParallel(const std::string& code, unsigned int threadCount);
+    static void warn(WarningSink& sink, WarningCode code, size_t lineNumber, std::string detail);
+};
\ No newline at end of file
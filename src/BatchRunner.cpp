@@ -0,0 +1,227 @@
+#include "BatchRunner.hpp"
+#include <mutex>
+#include <condition_variable>
+
+namespace {
+
+struct JobRange {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+/**
+* @brief Hands out blocks of jobs no further ahead than a window past the next result in order,
+*   collects the results from the workers and hands them out in job order.
+*/
+class ReorderBuffer {
+public:
+    ReorderBuffer(size_t total, size_t window, size_t block) : total(total), window(window), block(block) {}
+
+    /**
+    * @brief Takes the next block of jobs into the range, without waiting.
+    *
+    * @return false if every job is taken already or the window has no room for the block.
+    */
+    bool claim(JobRange& range) {
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!hasRoom()) return false;
+
+            begin = frontier;
+            end = std::min(total, frontier + block);
+            frontier = end;
+        }
+
+        std::lock_guard<std::mutex> lock(range.mutex);
+        range.begin = begin;
+        range.end = end;
+        return true;
+    }
+
+    /**
+    * @brief Waits until the window has room for another block, or every job is taken.
+    *
+    * @return false without waiting if every job was taken already.
+    */
+    bool waitForRoom() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (frontier == total) return false;
+
+        waiting++;
+        room.wait(lock, [this] { return frontier == total || hasRoom(); });
+        waiting--;
+        return true;
+    }
+
+    void push(BatchResult&& result) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.emplace(result.index, std::move(result));
+        }
+        ready.notify_one();
+    }
+
+    /**
+    * @brief Waits for the result with the next index in order.
+    */
+    BatchResult pop() {
+        BatchResult result;
+        bool everything = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return !pending.empty() && pending.begin()->first == next; });
+
+            result = std::move(pending.begin()->second);
+            pending.erase(pending.begin());
+            next++;
+            if (!waiting) return result;
+            everything = (frontier == total);
+            if (!everything && !hasRoom()) return result;
+        }
+        if (everything) room.notify_all();
+        else room.notify_one();
+
+        return result;
+    }
+
+private:
+    /**
+    * @brief Whether the next block ends within the window, waiting for a whole block keeps the workers from taking turns on single jobs.
+    */
+    bool hasRoom() const { return frontier < total && std::min(total, frontier + block) <= next + window; }
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable room;
+    std::map<size_t, BatchResult> pending;
+    size_t next = 0;
+    const size_t total;
+    const size_t window;
+    const size_t block;
+    size_t frontier = 0;                        // Jobs before it are taken
+    size_t waiting = 0;                         // Workers in waitForRoom
+};
+
+/**
+* @brief Takes the next job from the worker's own range.
+*/
+bool takeOwn(JobRange& range, size_t& index) {
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin >= range.end) {
+        return false;
+    }
+
+    index = range.begin++;
+    return true;
+}
+
+/**
+* @brief Moves the upper half of the largest other range into the worker's own range.
+*/
+bool steal(std::vector<JobRange>& ranges, size_t self) {
+    while (true) {
+        size_t victim = self;
+        size_t largest = 0;
+        for (size_t w = 0; w < ranges.size(); w++) {
+            if (w == self) continue;
+
+            std::lock_guard<std::mutex> lock(ranges[w].mutex);
+            size_t remaining = ranges[w].end - ranges[w].begin;
+            if (remaining > largest) {
+                largest = remaining;
+                victim = w;
+            }
+        }
+
+        if (victim == self) {
+            return false;
+        }
+
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(ranges[victim].mutex);
+            size_t remaining = ranges[victim].end - ranges[victim].begin;
+            if (remaining == 0) {
+                continue;
+            }
+
+            end = ranges[victim].end;
+            begin = end - (remaining + 1) / 2;
+            ranges[victim].end = begin;
+        }
+
+        std::lock_guard<std::mutex> lock(ranges[self].mutex);
+        ranges[self].begin = begin;
+        ranges[self].end = end;
+
+        return true;
+    }
+}
+
+}
+
+BatchRunner::BatchRunner(unsigned int threadCount, const ExecutionLimits& limits) : threadCount(threadCount), limits(limits) {
+    if (BatchRunner::threadCount == 0) {
+        BatchRunner::threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+void BatchRunner::run(const std::vector<BatchJob>& jobs, const std::function<void(BatchResult&)>& emit) const {
+    if (jobs.empty()) {
+        return;
+    }
+
+    size_t workerCount = std::min<size_t>(threadCount, jobs.size());
+    std::vector<JobRange> ranges(workerCount);
+
+    // Blocks small enough that every worker gets some of the window, and small batches still split evenly
+    const size_t block = std::max<size_t>(1, std::min(MaxPending / workerCount, (jobs.size() + workerCount - 1) / workerCount));
+    ReorderBuffer reorder(jobs.size(), MaxPending, block);
+
+    auto worker = [&](size_t self) {
+        VmState state;
+        state.setLimits(limits);
+        StringInput input;
+        StringOutput output;
+        std::ostringstream warningStream;
+
+        size_t index;
+        while (true) {
+            if (!takeOwn(ranges[self], index)) {
+                if (reorder.claim(ranges[self]) || steal(ranges, self)) continue;
+                if (!reorder.waitForRoom()) break;
+                continue;
+            }
+
+            const BatchJob& job = jobs[index];
+
+            state.reset();
+            input.set(job.input);
+            output.output.clear();
+            warningStream.str("");
+            StreamWarningSink warnings(warningStream);
+
+            ExecuteStatus status = AwaInterpreter::execute(*job.program, state, { input, output, warnings });
+            warnings.summary();
+
+            reorder.push({ index, std::move(output.output), warningStream.str(), status, state.executionStep });
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t w = 0; w < workerCount; w++) {
+        workers.emplace_back(worker, w);
+    }
+
+    for (size_t emitted = 0; emitted < jobs.size(); emitted++) {
+        BatchResult result = reorder.pop();
+        emit(result);
+    }
+
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
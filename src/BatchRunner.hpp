@@ -0,0 +1,50 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+#include <functional>
+#include <thread>
+
+struct BatchJob {
+    std::shared_ptr<const CompiledProgram> program;
+    std::string input;
+};
+
+struct BatchResult {
+    size_t index;
+    std::string output;
+    std::string warnings;
+    ExecuteStatus status;
+    uint64_t steps;
+};
+
+/**
+* @brief Runs many (program, input) jobs on a work-stealing thread pool.
+* @details Every worker owns one VmState which is reset between jobs. Workers take contiguous blocks of jobs,
+*   a worker that runs out of jobs steals the upper half of the largest remaining range.
+*   Results are passed through a reorder buffer, so they are emitted in job order no matter which worker finished first.
+*   No job further than MaxPending past the next result in order is started, so a slow job holds back at most
+*   MaxPending finished results in memory, the workers wait for it once they reach the end of the window.
+*/
+class BatchRunner {
+public:
+    /**
+    * @param threadCount The number of worker threads, 0 for one per hardware thread.
+    * @param limits The limits of every job, the timeout applies to each job separately.
+    */
+    explicit BatchRunner(unsigned int threadCount = 0, const ExecutionLimits& limits = {});
+
+    /**
+    * @brief Runs every job and emits the results in job order.
+    *
+    * @param jobs The jobs to be run.
+    * @param emit Called on the calling thread with each result, in job order.
+    */
+    void run(const std::vector<BatchJob>& jobs, const std::function<void(BatchResult&)>& emit) const;
+
+    unsigned int threads() const { return threadCount; }
+
+    static constexpr size_t MaxPending = 1024;
+
+private:
+    unsigned int threadCount;
+    ExecutionLimits limits;
+};
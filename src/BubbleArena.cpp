@@ -0,0 +1,91 @@
+#include "BubbleArena.hpp"
+#include <bit>
+
+static thread_local BubbleArena* activeArena = nullptr;
+
+BubbleArena::~BubbleArena() {
+    for (const Chunk& chunk : chunks) {
+        upstream->deallocate(chunk.begin, chunk.size, alignof(std::max_align_t));
+    }
+}
+
+bool BubbleArena::reset() {
+    if (live != 0) {
+        return false;
+    }
+
+    freeLists.fill(nullptr);
+    chunkIndex = 0;
+    cursor = chunks.empty() ? nullptr : chunks[0].begin;
+    chunkEnd = chunks.empty() ? nullptr : chunks[0].begin + chunks[0].size;
+    return true;
+}
+
+std::pmr::memory_resource* BubbleArena::resource() {
+    return activeArena ? static_cast<std::pmr::memory_resource*>(activeArena) : std::pmr::new_delete_resource();
+}
+
+BubbleArena::Scope::Scope(BubbleArena* arena) : previous(activeArena) {
+    activeArena = arena;
+}
+
+BubbleArena::Scope::~Scope() {
+    activeArena = previous;
+}
+
+size_t BubbleArena::sizeClass(size_t bytes) {
+    return std::bit_width((std::max(bytes, MinClassSize) - 1) / MinClassSize);
+}
+
+void BubbleArena::nextChunk(size_t bytes) {
+    // Reuse the chunks kept by reset before asking upstream for more
+    while (++chunkIndex < chunks.size()) {
+        if (chunks[chunkIndex].size >= bytes) {
+            cursor = chunks[chunkIndex].begin;
+            chunkEnd = cursor + chunks[chunkIndex].size;
+            return;
+        }
+    }
+
+    size_t size = std::max(bytes, chunks.empty() ? FirstChunkSize : chunks.back().size * 2);
+    chunks.push_back({ static_cast<char*>(upstream->allocate(size, alignof(std::max_align_t))), size });
+    chunkIndex = chunks.size() - 1;
+    reserved += size;
+    cursor = chunks.back().begin;
+    chunkEnd = cursor + size;
+}
+
+void* BubbleArena::do_allocate(size_t bytes, size_t alignment) {
+    live++;
+    if (bytes > MaxClassSize || alignment > MinClassSize) {
+        return upstream->allocate(bytes, alignment);
+    }
+
+    size_t index = sizeClass(bytes);
+    if (FreeBlock* block = freeLists[index]) {
+        freeLists[index] = block->next;
+        return block;
+    }
+
+    size_t size = MinClassSize << index;
+    if (static_cast<size_t>(chunkEnd - cursor) < size) {
+        nextChunk(size);
+    }
+
+    void* block = cursor;
+    cursor += size;
+    return block;
+}
+
+void BubbleArena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    live--;
+    if (bytes > MaxClassSize || alignment > MinClassSize) {
+        upstream->deallocate(p, bytes, alignment);
+        return;
+    }
+
+    size_t index = sizeClass(bytes);
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = freeLists[index];
+    freeLists[index] = block;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <memory_resource>
+#include <array>
+#include <vector>
+#include <cstddef>
+
+/**
+* @brief Memory resource of one VM, a monotonic arena with a free list per size class.
+* @details Blocks of up to MaxClassSize bytes are carved from chunks of doubling size and recycled through the free lists,
+*   larger or over-aligned blocks go to the upstream resource. Not thread safe, a VM runs on one thread at a time.
+*/
+class BubbleArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t ClassCount = 8;
+    static constexpr size_t MinClassSize = 16;
+    static constexpr size_t MaxClassSize = MinClassSize << (ClassCount - 1);
+    static constexpr size_t FirstChunkSize = 256;              // Every further chunk doubles, an idle VM holding a few double bubbles stays small
+
+    explicit BubbleArena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : upstream(upstream) {}
+    ~BubbleArena() override;
+
+    BubbleArena(const BubbleArena&) = delete;
+    BubbleArena& operator=(const BubbleArena&) = delete;
+
+    /**
+    * @brief Rewinds the arena to its first chunk and keeps the chunks for reuse, if every block was returned.
+    * @details Does nothing while blocks are still shared with snapshots or results, they stay valid
+    *   and the arena keeps carving from where it is, with what the free lists recycle.
+    *
+    * @return true if the arena was rewound.
+    */
+    bool reset();
+
+    size_t liveBlocks() const { return live; }
+    size_t reservedBytes() const { return reserved; }
+
+    /**
+    * @brief The arena bubbles are allocated from on this thread, the global heap if there is none.
+    */
+    static std::pmr::memory_resource* resource();
+
+    /**
+    * @brief Makes an arena the one of the current thread until the end of the scope.
+    */
+    class Scope {
+    public:
+        explicit Scope(BubbleArena* arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        BubbleArena* previous;
+    };
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    static size_t sizeClass(size_t bytes);
+    void nextChunk(size_t bytes);
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Chunk {
+        char* begin;
+        size_t size;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::array<FreeBlock*, ClassCount> freeLists{};
+    std::vector<Chunk> chunks;
+    size_t chunkIndex = 0;                      // The chunk the cursor is in
+    char* cursor = nullptr;
+    char* chunkEnd = nullptr;
+    size_t live = 0;                            // Blocks handed out and not returned yet
+    size_t reserved = 0;                        // Bytes of the chunks
+};
+
+/**
+* @brief Allocator drawing from the arena of the thread at the time it is constructed.
+* @details Copies keep drawing from the same arena, so a block is always returned to the arena it came from.
+*/
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() : resource(BubbleArena::resource()) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : resource(other.resource) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t n) { resource->deallocate(p, n * sizeof(T), alignof(T)); }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return resource == other.resource; }
+
+    std::pmr::memory_resource* resource;
+};
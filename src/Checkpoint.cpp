@@ -0,0 +1,206 @@
+#include "Checkpoint.hpp"
+#include "Varint.hpp"
+#include <fstream>
+#include <cstdio>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+static constexpr std::string_view Magic = "AWACKPT1";
+
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static uint64_t fnv1a(std::string_view bytes, uint64_t hash = 0xcbf29ce484222325ull) {
+    for (unsigned char c : bytes) {
+        hash = (hash ^ c) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+* @brief Simple bubbles are stored as (zigzag << 1), double bubbles as (size << 1 | 1) followed by their bubbles.
+*/
+static void putBubble(std::string& out, const Bubble& bubble) {
+    if (!isDouble(bubble)) {
+        putVarint(out, zigzag(std::get<int>(bubble.value)) << 1);
+        return;
+    }
+
+    const BubbleVector& list = getList(bubble);
+    putVarint(out, (static_cast<uint64_t>(list.size()) << 1) | 1);
+    for (const Bubble& b : list) {
+        putBubble(out, b);
+    }
+}
+
+/**
+* @brief Reads from a checkpoint, counting the bubbles it reads like AwaInterpreter::countBubbles.
+*/
+struct Reader : VarintReader {
+    size_t bubbles = 0;
+
+    Bubble bubble() {
+        bubbles++;
+        uint64_t tag = varint();
+        if (!(tag & 1)) {
+            return Bubble(static_cast<int>(unzigzag(tag >> 1)));
+        }
+
+        BubbleVector list;
+        uint64_t size = tag >> 1;
+        for (uint64_t i = 0; i < size && !failed; i++) {
+            list.push_back(bubble());
+        }
+        return Bubble(std::move(list));
+    }
+};
+
+uint64_t Checkpoint::hash(const CompiledProgram& program) {
+    uint64_t hash = fnv1a(program.legacy ? "1" : "0");
+    for (int value : program.data) {
+        hash = fnv1a(std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)), hash);
+    }
+    return hash;
+}
+
+std::string Checkpoint::serialize(const CompiledProgram& program, const VmState& state, const std::string& input, uint64_t outputBytes) {
+    std::string out(Magic);
+    putVarint(out, hash(program));
+    putVarint(out, state.pc);
+    putVarint(out, state.executionStep);
+    putVarint(out, state.terminated);
+    putVarint(out, outputBytes);
+    for (int r : state.bubblePond) {
+        putVarint(out, zigzag(r));
+    }
+
+    putVarint(out, input.size());
+    out += input;
+
+    putVarint(out, state.bubbleAbyss.size());
+    for (const Bubble& bubble : state.bubbleAbyss) {
+        putBubble(out, bubble);
+    }
+
+    putVarint(out, fnv1a(out));
+    return out;
+}
+
+bool Checkpoint::deserialize(std::string_view bytes, const CompiledProgram& program, VmState& state, std::string& input, uint64_t& outputBytes, std::string& error) {
+    if (bytes.substr(0, Magic.size()) != Magic) {
+        error = "Not a checkpoint";
+        return false;
+    }
+
+    Reader reader{ { bytes, Magic.size() } };
+    if (reader.varint() != hash(program)) {
+        error = "The checkpoint belongs to another program";
+        return false;
+    }
+
+    VmState restored;
+    restored.pc = reader.varint();
+    restored.executionStep = reader.varint();
+    restored.terminated = reader.varint() != 0;
+    outputBytes = reader.varint();
+    for (int& r : restored.bubblePond) {
+        r = static_cast<int>(unzigzag(reader.varint()));
+    }
+
+    input = std::string(reader.take(reader.varint()));
+
+    uint64_t abyssSize = reader.varint();
+    for (uint64_t i = 0; i < abyssSize && !reader.failed; i++) {
+        restored.bubbleAbyss.push_back(reader.bubble());
+    }
+
+    const size_t payload = reader.offset;
+    if (reader.failed || reader.varint() != fnv1a(bytes.substr(0, payload)) || restored.pc > program.data.size()) {
+        error = "The checkpoint is damaged";
+        return false;
+    }
+
+    state.bubbleAbyss = std::move(restored.bubbleAbyss);
+    state.bubblePond = restored.bubblePond;
+    state.pc = restored.pc;
+    state.executionStep = restored.executionStep;
+    state.terminated = restored.terminated;
+    state.bubbleCount = reader.bubbles;
+    state.startTimeout();
+
+    return true;
+}
+
+bool Checkpoint::writeFile(const std::string& path, std::string_view bytes) {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.write(bytes.data(), static_cast<std::streamsize>(bytes.size())) || !file.flush()) {
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    // rename does not replace an existing file on Windows, POSIX replaces it atomically so a checkpoint always exists
+    std::remove(path.c_str());
+#endif
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool Checkpointer::save(const CompiledProgram& program, const VmState& state, const std::string& input, uint64_t outputBytes) {
+    if (!reap(false)) {
+        return false;
+    }
+
+#ifndef _WIN32
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        bool written = Checkpoint::writeFile(path, Checkpoint::serialize(program, state, input, outputBytes));
+        _exit(written ? 0 : 1);
+    }
+    if (pid > 0) {
+        child = pid;
+        return true;
+    }
+#endif
+
+    // Without fork, or if it failed, the checkpoint is written in place
+    if (!Checkpoint::writeFile(path, Checkpoint::serialize(program, state, input, outputBytes))) {
+        std::cerr << "[Checkpoint] Error: Unable to write " << path << std::endl;
+    }
+    return true;
+}
+
+void Checkpointer::wait() {
+    reap(true);
+}
+
+bool Checkpointer::reap(bool block) {
+#ifndef _WIN32
+    if (child < 0) {
+        return true;
+    }
+
+    int status = 0;
+    pid_t done = waitpid(static_cast<pid_t>(child), &status, block ? 0 : WNOHANG);
+    if (done == 0) {
+        return false;
+    }
+
+    if (done > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+        std::cerr << "[Checkpoint] Error: Unable to write " << path << std::endl;
+    }
+    child = -1;
+#endif
+    return true;
+}
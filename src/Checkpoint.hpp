@@ -0,0 +1,67 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+
+/**
+* @brief Compact binary snapshots of an execution, to continue it in another process.
+* @details A checkpoint holds the program counter, the step, the abyss, the pond, the input of the reads and
+*   how many bytes were output, along with a hash of the program it belongs to. Integers are stored as varints.
+*/
+class Checkpoint {
+public:
+    /**
+    * @brief Hashes the decoded program, a checkpoint only restores onto the program it was taken from.
+    */
+    static uint64_t hash(const CompiledProgram& program);
+
+    static std::string serialize(const CompiledProgram& program, const VmState& state, const std::string& input, uint64_t outputBytes);
+
+    /**
+    * @brief Restores a checkpoint onto a state, the limits of the state are kept and its timeout restarts.
+    *
+    * @param bytes The serialized checkpoint.
+    * @param program The program being resumed.
+    * @param state Receives the state of the execution.
+    * @param input Receives the input of the reads.
+    * @param outputBytes Receives how many bytes had been output.
+    * @param error Receives the reason on failure.
+    *
+    * @return true if the checkpoint was restored.
+    */
+    static bool deserialize(std::string_view bytes, const CompiledProgram& program, VmState& state, std::string& input, uint64_t& outputBytes, std::string& error);
+
+    /**
+    * @brief Writes a file through a temporary file and a rename, so an interrupted write never replaces the last checkpoint.
+    */
+    static bool writeFile(const std::string& path, std::string_view bytes);
+};
+
+/**
+* @brief Writes checkpoints to one file in the background.
+* @details Where fork is available, the snapshot is serialized and written by a forked child on a copy-on-write view
+*   of the memory, so the execution does not pause. Elsewhere it is written synchronously.
+*/
+class Checkpointer {
+public:
+    explicit Checkpointer(std::string path) : path(std::move(path)) {}
+    ~Checkpointer() { wait(); }
+
+    /**
+    * @brief Starts writing a checkpoint.
+    *
+    * @return false if the previous checkpoint is still being written, the checkpoint is skipped then.
+    */
+    bool save(const CompiledProgram& program, const VmState& state, const std::string& input, uint64_t outputBytes);
+
+    /**
+    * @brief Waits until the last checkpoint is written.
+    */
+    void wait();
+
+    const std::string& file() const { return path; }
+
+private:
+    bool reap(bool block);
+
+    std::string path;
+    long child = -1;
+};
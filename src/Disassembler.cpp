@@ -0,0 +1,195 @@
+#include "Disassembler.hpp"
+
+static constexpr std::string_view AwaSCII = "AWawJELYHOSIUMjelyhosiumPCNTpcntBDFGRbdfgr0123456789 .,!'()~_/;\n";
+
+/**
+* @brief Counts the parameters the decoder puts after an instruction, flags included.
+*/
+static int parameterCount(int instruction, bool legacy) {
+    switch (instruction) {
+    case blw:
+    case sbm:
+    case srn:
+    case jmp:
+        return legacy ? 1 : 2;
+    case lbl:
+        return legacy ? 1 : 0;
+    case pop:
+        return legacy ? 0 : 1;
+    case mov:
+        return legacy ? 0 : 3;
+    default:
+        return 0;
+    }
+}
+
+Disassembler::Disassembler(std::ostream& os, bool characters) : os(os), characters(characters) {
+    buffer.reserve(1 << 16);
+}
+
+void Disassembler::feed(std::string_view awalang) {
+    pending.append(awalang);
+    decode(false);
+}
+
+void Disassembler::finish() {
+    decode(true);
+
+    // An instruction cut off by the end of the code is written without its parameters
+    if (instruction >= 0) {
+        expectedParameters = parameterCount = 0;
+        writeInstruction();
+    }
+    flush();
+}
+
+void Disassembler::disassemble(const CompiledProgram& program, std::ostream& os, bool characters) {
+    Disassembler disassembler(os, characters);
+    disassembler.legacy = program.legacy;
+    for (int value : program.data) {
+        disassembler.pushValue(value);
+    }
+    disassembler.finish();
+}
+
+void Disassembler::decode(bool final) {
+    const std::string_view text = pending;
+    size_t i = 0;
+
+    // Same rules as AwaInterpreter::ReadAwatalk, which needs 6 characters after a header candidate
+    if (!decoder) {
+        while (!decoder && text.size() - i > 6) {
+            if (text.compare(i, 6, "awawa ") == 0) {
+                decoder.emplace(legacy = false);
+                i += 5;
+            }
+            else if (text.compare(i, 4, "awa ") == 0) {
+                decoder.emplace(legacy = true);
+                i += 3;
+            }
+            else {
+                i++;
+            }
+        }
+
+        if (!decoder) {
+            pending.erase(0, final ? pending.size() : i);
+            return;
+        }
+    }
+
+    // "wa" is a 1 bit, " awa" a 0 bit, anything else is skipped
+    int value;
+    while (text.size() - i >= (final ? 2 : 4)) {
+        int bit;
+        if (text.compare(i, 2, "wa") == 0) {
+            bit = 1;
+            i += 2;
+        }
+        else if (text.size() - i >= 4 && text.compare(i, 4, " awa") == 0) {
+            bit = 0;
+            i += 4;
+        }
+        else {
+            i++;
+            continue;
+        }
+
+        if (decoder->push(bit, value)) pushValue(value);
+    }
+
+    pending.erase(0, final ? pending.size() : i);
+}
+
+void Disassembler::pushValue(int value) {
+    if (instruction < 0) {
+        instruction = value;
+        parameterCount = 0;
+        expectedParameters = ::parameterCount(value, legacy);
+    }
+    else {
+        parameters[parameterCount++] = value;
+    }
+
+    if (parameterCount == expectedParameters) {
+        writeInstruction();
+    }
+}
+
+void Disassembler::writeInstruction() {
+    if (instruction == lbl) {
+        buffer += '\n';
+    }
+
+    buffer += awatismName(instruction);
+
+    if (parameterCount == expectedParameters && expectedParameters > 0) {
+        buffer += ' ';
+        if (legacy) {
+            if (instruction == blw) writeCharacter(parameters[0]);
+            else buffer += std::to_string(parameters[0]);
+        }
+        else {
+            switch (instruction) {
+            case pop:
+                buffer += 'r' + std::to_string(parameters[0]);
+                break;
+            case mov:
+                buffer += 'r' + std::to_string(parameters[1]) + ", ";
+                if (parameters[0]) buffer += 'r' + std::to_string(parameters[2]);
+                else writeCharacter(parameters[2]);
+                break;
+            default:
+                if (parameters[0]) buffer += 'r' + std::to_string(parameters[1]);
+                else if (instruction == blw) writeCharacter(parameters[1]);
+                else buffer += std::to_string(parameters[1]);
+                break;
+            }
+        }
+    }
+    buffer += '\n';
+
+    instruction = -1;
+    if (buffer.size() >= (1 << 16)) {
+        flush();
+    }
+}
+
+void Disassembler::writeCharacter(int value) {
+    if (characters) {
+        // ';' would split the line, so it stays a number
+        char c = '\0';
+        if (legacy && value >= 0 && value < static_cast<int>(AwaSCII.size())) c = AwaSCII[value];
+        else if (!legacy && (value == '\t' || value == '\n' || value == '\r' || (value >= ' ' && value <= '~'))) c = static_cast<char>(value);
+
+        switch (c) {
+        case '\0':
+        case ';':
+            break;
+        case ' ':
+            buffer += "S(space)";
+            return;
+        case '\t':
+            buffer += "S(\\t)";
+            return;
+        case '\n':
+            buffer += "S(\\n)";
+            return;
+        case '\r':
+            buffer += "S(\\r)";
+            return;
+        default:
+            buffer += "S(";
+            buffer += c;
+            buffer += ')';
+            return;
+        }
+    }
+
+    buffer += std::to_string(value);
+}
+
+void Disassembler::flush() {
+    os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+}
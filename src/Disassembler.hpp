@@ -0,0 +1,53 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+#include <ostream>
+#include <optional>
+
+/**
+* @brief Turns Awalang, or the data of a compiled program, back into Awably.
+* @details Awalang is fed in chunks of any size and the Awably is written as soon as each instruction is decoded,
+*   so inputs of any size are disassembled in constant memory. Every label is preceded by an empty line,
+*   AWA5.0++ register operands are written as rN. Legacy output assembles back into the same Awalang.
+*/
+class Disassembler {
+public:
+    /**
+    * @param os The stream receiving the Awably.
+    * @param characters Whether to write blown values as S(x) where Awably can express them, numbers otherwise.
+    */
+    explicit Disassembler(std::ostream& os, bool characters = false);
+
+    /**
+    * @brief Decodes the next chunk of Awalang, starting with the chunk holding the header.
+    */
+    void feed(std::string_view awalang);
+
+    /**
+    * @brief Decodes what is left of the Awalang and flushes the Awably to the stream.
+    */
+    void finish();
+
+    /**
+    * @brief Disassembles a compiled program.
+    */
+    static void disassemble(const CompiledProgram& program, std::ostream& os, bool characters = false);
+
+private:
+    void decode(bool final);
+    void pushValue(int value);
+    void writeInstruction();
+    void writeCharacter(int value);
+    void flush();
+
+    std::ostream& os;
+    bool characters;
+    bool legacy = false;
+    std::optional<AwatalkDecoder> decoder;      // Set once the header is found
+    std::string pending;                        // Awalang not decoded yet, at most a few characters between chunks
+    std::string buffer;                         // Awably not written yet
+
+    int instruction = -1;                       // -1 if no instruction is waiting for its parameters
+    int parameters[3] = {};
+    int parameterCount = 0;
+    int expectedParameters = 0;
+};
@@ -0,0 +1,240 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+#include "Awabler.hpp"
+#include "LoopIdioms.hpp"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+/**
+* @brief A string literal usable as a template argument, so programs can be decoded from it at compile time.
+*/
+template <size_t N>
+struct FixedString {
+    char chars[N]{};
+
+    constexpr FixedString(const char (&literal)[N]) {
+        std::copy_n(literal, N, chars);
+    }
+
+    constexpr std::string_view view() const { return { chars, N - 1 }; }
+};
+
+/**
+* @brief A program decoded at compile time, see embedAwalang and embedAwably.
+* @details The same instructions and labels AwaInterpreter::compile produces for the program, so running it needs no parsing.
+*/
+template <size_t Size, size_t LabelCount>
+struct EmbeddedProgram {
+    std::array<int, Size> data{};
+    std::array<std::pair<int, size_t>, LabelCount> labels{};    // Label and position of its parameter, sorted by label
+    bool legacy = false;
+
+    /**
+    * @brief Returns the position a label jumps to, the index of its parameter like in CompiledProgram::lblTable.
+    *
+    * @return The position, Size if the label is not defined.
+    */
+    constexpr size_t labelPosition(int label) const {
+        for (const auto& [defined, position] : labels) {
+            if (defined == label) return position;
+        }
+        return Size;
+    }
+
+    /**
+    * @brief Copies the program into the form the execution engine runs, nothing is decoded but its loops are recognized.
+    */
+    std::shared_ptr<const CompiledProgram> toProgram() const {
+        auto program = std::make_shared<CompiledProgram>();
+        program->data.assign(data.begin(), data.end());
+        for (const auto& [label, position] : labels) {
+            program->lblTable.emplace_hint(program->lblTable.end(), label, position);
+        }
+        program->legacy = legacy;
+        LoopIdioms::recognize(*program);
+        return program;
+    }
+};
+
+/**
+* @brief Compile time decoding of embedded programs, a malformed program is not a constant expression and fails the build.
+*/
+namespace embedded {
+
+/**
+* @brief Not constexpr, reaching it during constant evaluation stops the build with the reason in the error.
+*/
+inline void malformed(const char* reason) {
+    (void)reason;
+}
+
+constexpr bool isAwatism(int code, bool legacy) {
+    return (code >= 0 && code <= (legacy ? 20 : 21)) || code == trm;
+}
+
+/**
+* @brief Decodes Awalang like AwaInterpreter::ReadAwatalk, but fails on anything the runtime would silently skip.
+*
+* @return Whether the code has the legacy header.
+*/
+template <typename Emit>
+constexpr bool scanAwalang(std::string_view code, Emit&& emit) {
+    bool legacy = false;
+    size_t count = 0;
+    AwalangScan scan = ::decodeAwalang(code, legacy, [&](int value, bool instruction) {
+        if (instruction && !isAwatism(value, legacy)) malformed("Undefined instruction");
+        emit(value);
+        count++;
+    });
+
+    if (!scan.header) malformed("Neither the awa nor the awawa header is found");
+    if (!scan.complete) malformed("The code ends within an instruction or its parameters");
+    if (count == 0) malformed("The code has no instructions");
+    return legacy;
+}
+
+/**
+* @brief Assembles Awably like AwaInterpreter::compileAwably, but fails on every line the Awabler would warn about.
+*/
+template <typename Emit>
+constexpr void scanAwably(std::string_view code, bool legacy, Emit&& emit) {
+    AwatalkDecoder decoder(false);
+    auto pushBits = [&](int value, int length) {
+        int decoded = 0;
+        for (int i = length - 1; i >= 0; i--) {
+            if (decoder.push((value >> i) & 1, decoded)) emit(decoded);
+        }
+    };
+
+    size_t count = 0;
+    Awabler::forEachLine(code, [&](std::string_view line) {
+        size_t pos = line.find(' ');
+        std::string_view instruction = line.substr(0, pos);
+        int instructionCode = Awabler::awatismCode(instruction);
+        int paramLength = Awabler::parameterLength(instruction);
+        if (instructionCode < 0) malformed("Undefined instruction");
+
+        int parameter = 0;
+        if (pos == std::string_view::npos) {
+            if (paramLength) malformed("The instruction requires a parameter");
+        }
+        else {
+            std::string_view paramStr = Awabler::trim(line.substr(pos + 1));
+            if (!paramLength) malformed("The instruction does not take a parameter");
+
+            if (paramStr.size() >= 3 && paramStr.substr(0, 2) == "S(" && paramStr.back() == ')') {
+                parameter = Awabler::awaSCIICode(paramStr.substr(2, paramStr.size() - 3), legacy);
+                if (parameter < 0) malformed("Undefined token");
+            }
+            else if (!Awabler::parseInt(paramStr, parameter)) {
+                malformed("Invalid parameter");
+            }
+        }
+
+        // Same layouts as AwaInterpreter::appendAwably, AWA5.0++ parameters depend on flag bits the Awabler does not emit
+        if (legacy) {
+            emit(instructionCode);
+            if (paramLength) emit((paramLength == 8) ? static_cast<int8_t>(parameter & 0xFF) : (parameter & 0x1F));
+        }
+        else {
+            pushBits(instructionCode, 5);
+            if (paramLength) pushBits(parameter, paramLength);
+        }
+        count++;
+    });
+
+    if (!decoder.complete()) malformed("The code ends within an instruction or its parameters");
+    if (count == 0) malformed("The code has no instructions");
+}
+
+/**
+* @brief The decoded instructions before the labels are collected.
+*/
+template <size_t Size>
+struct Decoded {
+    std::array<int, Size> data{};
+    bool legacy = false;
+};
+
+template <FixedString Code>
+consteval auto decodeAwalang() {
+    constexpr size_t size = [] {
+        size_t count = 0;
+        scanAwalang(Code.view(), [&count](int) { count++; });
+        return count;
+    }();
+
+    Decoded<size> decoded;
+    size_t i = 0;
+    decoded.legacy = scanAwalang(Code.view(), [&](int value) { decoded.data[i++] = value; });
+    return decoded;
+}
+
+template <FixedString Code, bool Legacy>
+consteval auto decodeAwably() {
+    constexpr size_t size = [] {
+        size_t count = 0;
+        scanAwably(Code.view(), Legacy, [&count](int) { count++; });
+        return count;
+    }();
+
+    Decoded<size> decoded;
+    size_t i = 0;
+    scanAwably(Code.view(), Legacy, [&](int value) { decoded.data[i++] = value; });
+    decoded.legacy = Legacy;
+    return decoded;
+}
+
+/**
+* @brief Collects the labels like AwaInterpreter::buildLabelTable, a label defined twice jumps to its last definition.
+*/
+template <auto Program>
+consteval auto withLabels() {
+    constexpr size_t labelCount = [] {
+        std::array<int, Program.data.size()> seen{};
+        size_t count = 0;
+        forEachLabel(Program.data, 0, [&](int label, size_t) {
+            if (std::find(seen.begin(), seen.begin() + count, label) == seen.begin() + count) seen[count++] = label;
+        });
+        return count;
+    }();
+
+    EmbeddedProgram<Program.data.size(), labelCount> program;
+    program.data = Program.data;
+    program.legacy = Program.legacy;
+
+    size_t count = 0;
+    forEachLabel(Program.data, 0, [&](int label, size_t position) {
+        auto end = program.labels.begin() + count;
+        auto it = std::find_if(program.labels.begin(), end, [label](const auto& entry) { return entry.first == label; });
+        if (it != end) it->second = position;
+        else program.labels[count++] = { label, position };
+    });
+    std::sort(program.labels.begin(), program.labels.end());
+    return program;
+}
+
+}
+
+/**
+* @brief Decodes Awalang at compile time, the dialect follows the header like AwaInterpreter::compile.
+* @details Fails the build on a missing header, an undefined instruction or code ending within an instruction.
+*
+* Usage: constexpr auto hello = embedAwalang<"awa awa awawa awawa ...">();
+*/
+template <FixedString Code>
+consteval auto embedAwalang() {
+    return embedded::withLabels<embedded::decodeAwalang<Code>()>();
+}
+
+/**
+* @brief Assembles Awably at compile time, the program is the same as AwaInterpreter::compileAwably with Awabler::legacy set to Legacy.
+* @details Fails the build on every line the Awabler would warn about.
+*
+* Usage: constexpr auto countdown = embedAwably<"blw 3; lbl 0; ...", true>();
+*/
+template <FixedString Code, bool Legacy>
+consteval auto embedAwably() {
+    return embedded::withLabels<embedded::decodeAwably<Code, Legacy>()>();
+}
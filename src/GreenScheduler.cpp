@@ -0,0 +1,124 @@
+#include "GreenScheduler.hpp"
+
+GreenScheduler::GreenScheduler(unsigned int workerCount, unsigned int sliceSteps) : sliceSteps(sliceSteps) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(workerCount);
+    for (unsigned int w = 0; w < workerCount; w++) {
+        workers.emplace_back(&GreenScheduler::work, this);
+    }
+}
+
+GreenScheduler::~GreenScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    readyChanged.notify_all();
+
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+GreenScheduler::VmId GreenScheduler::spawn(std::shared_ptr<const CompiledProgram> program, std::optional<std::string> input, const ExecutionLimits& limits) {
+    auto vm = std::make_unique<GreenVm>();
+    vm->program = std::move(program);
+    vm->input.input = std::move(input);
+    vm->state.setLimits(limits);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    VmId id = vms.size();
+    readyQueue.push_back(vm.get());
+    vms.push_back(std::move(vm));
+    readyChanged.notify_one();
+
+    return id;
+}
+
+void GreenScheduler::feed(VmId id, std::string input) {
+    std::lock_guard<std::mutex> lock(mutex);
+    GreenVm& vm = *vms.at(id);
+    if (vm.status == GreenVm::Status::Finished) {
+        return;
+    }
+    vm.pendingInput = std::move(input);
+
+    if (vm.status == GreenVm::Status::Parked) {
+        vm.status = GreenVm::Status::Ready;
+        readyQueue.push_back(&vm);
+        readyChanged.notify_one();
+    }
+}
+
+void GreenScheduler::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return readyQueue.empty() && running == 0; });
+}
+
+GreenVm::Status GreenScheduler::status(VmId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return vms.at(id)->status;
+}
+
+const GreenVm* GreenScheduler::finished(VmId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    GreenVm* vm = vms.at(id).get();
+    return (vm->status == GreenVm::Status::Finished) ? vm : nullptr;
+}
+
+size_t GreenScheduler::switches() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalSlices;
+}
+
+void GreenScheduler::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        readyChanged.wait(lock, [this] { return stopping || !readyQueue.empty(); });
+        if (stopping) {
+            return;
+        }
+
+        GreenVm* vm = readyQueue.front();
+        readyQueue.pop_front();
+        vm->status = GreenVm::Status::Running;
+        if (vm->pendingInput) {
+            vm->input.input = std::move(vm->pendingInput);
+            vm->pendingInput.reset();
+        }
+        running++;
+        totalSlices++;
+        lock.unlock();
+
+        ExecuteStatus status = AwaInterpreter::execute(*vm->program, vm->state, { vm->input, vm->output, vm->warnings }, sliceSteps);
+
+        lock.lock();
+        running--;
+        switch (status) {
+        case ExecuteStatus::Yielded:
+            vm->status = GreenVm::Status::Ready;
+            readyQueue.push_back(vm);
+            break;
+        case ExecuteStatus::WaitingForInput:
+            if (vm->pendingInput) {
+                vm->status = GreenVm::Status::Ready;
+                readyQueue.push_back(vm);
+            }
+            else {
+                vm->status = GreenVm::Status::Parked;
+            }
+            break;
+        default:
+            vm->status = GreenVm::Status::Finished;
+            vm->result = status;
+            break;
+        }
+
+        if (readyQueue.empty() && running == 0) {
+            idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/**
+* @brief Input source whose input arrives after the execution started.
+* @details Not ready until GreenScheduler::feed delivers the input, every read after that sees the whole input.
+*/
+class ChannelInput : public InputSource {
+public:
+    std::string_view read() override { return input ? std::string_view(*input) : std::string_view(); }
+    bool ready() override { return input.has_value(); }
+
+    std::optional<std::string> input;
+};
+
+/**
+* @brief One green thread, a VmState with its own sinks.
+*/
+struct GreenVm {
+    enum class Status {
+        Ready,
+        Running,
+        Parked,
+        Finished
+    };
+
+    std::shared_ptr<const CompiledProgram> program;
+    VmState state;
+    ChannelInput input;
+    StringOutput output;
+    WarningLog warnings;
+    Status status = Status::Ready;
+    ExecuteStatus result = ExecuteStatus::Finished;
+    std::optional<std::string> pendingInput;
+};
+
+/**
+* @brief Cooperative scheduler multiplexing any number of VMs over a fixed set of worker threads.
+* @details A worker executes a VM for one time slice, then puts it back at the end of the ready queue.
+*   A VM that reads an input which has not arrived yet is parked instead of blocking its worker, and becomes ready again once it is fed.
+*/
+class GreenScheduler {
+public:
+    using VmId = size_t;
+
+    /**
+    * @param workerCount The number of worker threads, 0 for one per hardware thread.
+    * @param sliceSteps The number of steps a VM executes before it yields its worker.
+    */
+    explicit GreenScheduler(unsigned int workerCount = 0, unsigned int sliceSteps = 1024);
+    ~GreenScheduler();
+
+    GreenScheduler(const GreenScheduler&) = delete;
+    GreenScheduler& operator=(const GreenScheduler&) = delete;
+
+    /**
+    * @brief Creates a VM and schedules it.
+    *
+    * @param program The program the VM runs.
+    * @param input The input of the VM, if not given the VM parks on its first read until it is fed.
+    * @param limits The limits of the VM, its timeout starts when it is spawned.
+    *
+    * @return The id of the VM.
+    */
+    VmId spawn(std::shared_ptr<const CompiledProgram> program, std::optional<std::string> input = std::nullopt, const ExecutionLimits& limits = {});
+
+    /**
+    * @brief Delivers the input of a VM, waking it up if it is parked on a read. A finished VM ignores it.
+    */
+    void feed(VmId id, std::string input);
+
+    /**
+    * @brief Waits until every VM has either finished or is parked on a read.
+    */
+    void wait();
+
+    GreenVm::Status status(VmId id);
+
+    /**
+    * @brief Retrieves a finished VM, which no worker touches again.
+    *
+    * @return nullptr if the VM has not finished yet.
+    */
+    const GreenVm* finished(VmId id);
+
+    /**
+    * @return The number of slices executed so far.
+    */
+    size_t switches();
+
+private:
+    void work();
+
+    unsigned int sliceSteps;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable readyChanged;
+    std::condition_variable idle;
+    std::deque<std::unique_ptr<GreenVm>> vms;
+    std::deque<GreenVm*> readyQueue;
+    size_t running = 0;
+    size_t totalSlices = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,363 @@
+#include "Lockstep.hpp"
+#include <algorithm>
+
+void LockstepStats::print(std::ostream& out) const {
+    out << "[LockstepRunner] " << lanes << " lanes in " << groups << " groups: " << lockstepLanes << " ran in lockstep, "
+        << divergedLanes << " diverged at a conditional, " << scalarLanes << " continued on scalar VMs, "
+        << lockstepSteps << " steps executed for whole groups." << std::endl;
+}
+
+/**
+* @brief The lanes of one group, their abysses stored as one array of lanes per depth.
+*/
+class LockstepRunner::Group {
+public:
+    Group(const LockstepRunner& runner, const CompiledProgram& program, const std::vector<std::string>& inputs, size_t first, size_t count,
+        VmState& scalar, LockstepStats& stats);
+
+    /**
+    * @brief Runs every lane to its end, in lockstep as long as possible.
+    */
+    void run();
+
+    std::vector<BatchResult> results;       // Indexed by job, relative to the first job of the group
+
+private:
+    int* slot(size_t index) { return values.data() + index * lanes.size(); }
+
+    int* push() {
+        values.resize((depth + 1) * lanes.size());
+        return slot(depth++);
+    }
+
+    void drop() {
+        values.resize(--depth * lanes.size());
+    }
+
+    /**
+    * @brief Continues the leaving lanes on the scalar VmState from the position and removes them from the group.
+    */
+    void split(const std::vector<bool>& leaving, size_t pc);
+
+    /**
+    * @brief Ends every lane still in the group.
+    */
+    void finish(ExecuteStatus status);
+
+    const ExecutionLimits& limits;
+    const CompiledProgram& program;
+    const std::vector<std::string>& inputs;
+    const size_t first;
+    VmState& scalar;
+    LockstepStats& stats;
+
+    std::vector<size_t> lanes;              // Job index of every lane in the group
+    std::vector<std::string> outputs;
+    std::vector<int> numbers;               // What r3d reads in each lane, the input is the same on every read
+    std::vector<int> values;                // depth arrays of lanes.size() values, the bottom of the abysses first
+    size_t depth = 0;
+    uint64_t executionStep = 0;
+};
+
+LockstepRunner::Group::Group(const LockstepRunner& runner, const CompiledProgram& program, const std::vector<std::string>& inputs, size_t first, size_t count,
+    VmState& scalar, LockstepStats& stats)
+    : results(count), limits(runner.limits), program(program), inputs(inputs), first(first), scalar(scalar), stats(stats), outputs(count) {
+    lanes.reserve(count);
+    numbers.reserve(count);
+    for (size_t index = first; index < first + count; index++) {
+        lanes.push_back(index);
+        numbers.push_back(AwaInterpreter::readNumber(inputs[index]));
+    }
+}
+
+void LockstepRunner::Group::split(const std::vector<bool>& leaving, size_t pc) {
+    const size_t width = lanes.size();
+    std::vector<size_t> kept;
+    for (size_t lane = 0; lane < width; lane++) {
+        if (!leaving[lane]) {
+            kept.push_back(lane);
+            continue;
+        }
+
+        const size_t index = lanes[lane];
+        scalar.reset();
+        for (size_t d = 0; d < depth; d++) {
+            scalar.bubbleAbyss.emplace_back(values[d * width + lane]);
+        }
+        scalar.pc = pc;
+        scalar.executionStep = executionStep;
+        if (limits.maxBubbles) scalar.bubbleCount = depth;
+
+        StringInput input(inputs[index]);
+        StringOutput output;
+        output.output = std::move(outputs[lane]);
+        std::ostringstream warningStream;
+        StreamWarningSink warnings(warningStream);
+
+        ExecuteStatus status = AwaInterpreter::execute(program, scalar, { input, output, warnings });
+        warnings.summary();
+        results[index - first] = { index, std::move(output.output), warningStream.str(), status, scalar.executionStep };
+    }
+
+    // Compacts the remaining lanes, the arrays of every depth shrink to the new width
+    std::vector<int> remaining(depth * kept.size());
+    for (size_t d = 0; d < depth; d++) {
+        for (size_t k = 0; k < kept.size(); k++) {
+            remaining[d * kept.size() + k] = values[d * width + kept[k]];
+        }
+    }
+    values = std::move(remaining);
+
+    for (size_t k = 0; k < kept.size(); k++) {
+        lanes[k] = lanes[kept[k]];
+        if (kept[k] != k) outputs[k] = std::move(outputs[kept[k]]);
+        numbers[k] = numbers[kept[k]];
+    }
+    lanes.resize(kept.size());
+    outputs.resize(kept.size());
+    numbers.resize(kept.size());
+}
+
+void LockstepRunner::Group::finish(ExecuteStatus status) {
+    for (size_t lane = 0; lane < lanes.size(); lane++) {
+        results[lanes[lane] - first] = { lanes[lane], std::move(outputs[lane]), "", status, executionStep };
+    }
+    stats.lockstepLanes += lanes.size();
+    lanes.clear();
+}
+
+void LockstepRunner::Group::run() {
+    if (!program.legacy) {
+        stats.scalarLanes += lanes.size();
+        split(std::vector<bool>(lanes.size(), true), 0);
+        return;
+    }
+
+    const std::vector<int>& data = program.data;
+    const std::map<int, size_t>& lblTable = program.lblTable;
+    const bool checkingJumps = limits.maxSteps != 0 || limits.timeout.count() != 0;
+    const auto deadline = limits.timeout.count() ? std::chrono::steady_clock::now() + limits.timeout : std::chrono::steady_clock::time_point::max();
+    unsigned int backwardJumps = 0;
+    size_t i = 0;
+
+    while (!lanes.empty()) {
+        if (i >= data.size()) {
+            finish(ExecuteStatus::Finished);
+            break;
+        }
+
+        const size_t opStart = i;
+        const size_t width = lanes.size();
+        std::optional<ExecuteStatus> limitHit;
+        bool scalarOnly = false;
+
+        // Compares the top two values of every lane, a split re-runs the conditional on the lanes that stayed
+        auto condition = [&](auto compare) {
+            if (depth < 2) {
+                scalarOnly = true;
+                return false;
+            }
+
+            const int* b1 = slot(depth - 1);
+            const int* b2 = slot(depth - 2);
+            std::vector<bool> taken(width);
+            size_t count = 0;
+            for (size_t lane = 0; lane < width; lane++) {
+                taken[lane] = compare(b1[lane], b2[lane]);
+                count += taken[lane];
+            }
+
+            if (count != 0 && count != width) {
+                const bool leavingSide = count * 2 < width;
+                std::vector<bool> leaving(width);
+                for (size_t lane = 0; lane < width; lane++) leaving[lane] = taken[lane] == leavingSide;
+                stats.divergedLanes += leavingSide ? count : width - count;
+                split(leaving, opStart);
+                return true;
+            }
+
+            if (count == 0) AwaInterpreter::skipNextInstruction(data, i);
+            return false;
+        };
+
+        // Wraps like the scalar engine does in practice, without signed overflow
+        auto arithmetic = [&](auto apply) {
+            if (depth < 2) {
+                scalarOnly = true;
+                return;
+            }
+
+            const int* b1 = slot(depth - 1);
+            int* b2 = slot(depth - 2);
+            for (size_t lane = 0; lane < width; lane++) {
+                b2[lane] = static_cast<int>(apply(static_cast<unsigned int>(b1[lane]), static_cast<unsigned int>(b2[lane])));
+            }
+            drop();
+        };
+
+        bool diverged = false;
+        switch (data[i]) {
+            case nop:
+                break;
+            case prn:
+            case pr1:
+                if (depth == 0) {
+                    scalarOnly = true;
+                    break;
+                }
+                for (size_t lane = 0; lane < width; lane++) {
+                    AwaInterpreter::printBubble<true>(Bubble(slot(depth - 1)[lane]), data[i] == pr1, outputs[lane]);
+                }
+                drop();
+                break;
+            case r3d: {
+                std::vector<bool> empty(width);
+                bool anyEmpty = false;
+                for (size_t lane = 0; lane < width; lane++) {
+                    empty[lane] = inputs[lanes[lane]].empty();
+                    anyEmpty |= empty[lane];
+                }
+                if (anyEmpty) {
+                    stats.scalarLanes += std::count(empty.begin(), empty.end(), true);
+                    split(empty, opStart);
+                    diverged = true;
+                    break;
+                }
+
+                int* top = push();
+                std::copy(numbers.begin(), numbers.end(), top);
+                break;
+            }
+            case blw:
+                if (i + 1 < data.size()) {
+                    int value = data[++i];
+                    int* top = push();
+                    std::fill(top, top + width, value);
+                }
+                else {
+                    scalarOnly = true;
+                }
+                break;
+            case sbm:
+                if (i + 1 < data.size() && depth > 0) {
+                    int pos = data[++i];
+                    auto end = values.begin() + depth * width;
+                    if (pos == 0) {
+                        std::rotate(values.begin(), end - width, end);
+                    }
+                    else if (pos > 0 && static_cast<size_t>(pos) <= depth - 1) {
+                        std::rotate(end - (pos + 1) * width, end - width, end);
+                    }
+                    else {
+                        drop();
+                    }
+                }
+                else {
+                    scalarOnly = true;
+                }
+                break;
+            case pop:
+                if (depth > 0) drop();
+                else scalarOnly = true;
+                break;
+            case dpl:
+                if (depth > 0) {
+                    int* top = push();
+                    std::copy(top - width, top, top);
+                }
+                else {
+                    scalarOnly = true;
+                }
+                break;
+            case add:
+                arithmetic([](unsigned int a, unsigned int b) { return a + b; });
+                break;
+            case sub:
+                arithmetic([](unsigned int a, unsigned int b) { return a - b; });
+                break;
+            case mul:
+                arithmetic([](unsigned int a, unsigned int b) { return a * b; });
+                break;
+            case cnt: {
+                int* top = push();
+                std::fill(top, top + width, 0);
+                break;
+            }
+            case lbl:
+                if (i + 1 < data.size()) i++;
+                else scalarOnly = true;
+                break;
+            case jmp: {
+                auto target = (i + 1 < data.size()) ? lblTable.find(data[i + 1]) : lblTable.end();
+                if (target == lblTable.end()) {
+                    scalarOnly = true;
+                    break;
+                }
+
+                i++;
+                if (checkingJumps && target->second < i) {
+                    if (limits.maxSteps && executionStep >= limits.maxSteps) {
+                        limitHit = ExecuteStatus::StepLimit;
+                    }
+                    else if ((++backwardJumps & 0xFF) == 0 && std::chrono::steady_clock::now() >= deadline) {
+                        limitHit = ExecuteStatus::Timeout;
+                    }
+                }
+                i = target->second;
+                break;
+            }
+            case eql:
+                diverged = condition([](int b1, int b2) { return b1 == b2; });
+                break;
+            case lss:
+                diverged = condition([](int b1, int b2) { return b1 < b2; });
+                break;
+            case gr8:
+                diverged = condition([](int b1, int b2) { return b1 > b2; });
+                break;
+            case trm:
+                limitHit = ExecuteStatus::Terminated;
+                break;
+            default:
+                // red, srn, mrg and div create double bubbles
+                scalarOnly = true;
+                break;
+        }
+
+        if (scalarOnly) {
+            stats.scalarLanes += width;
+            split(std::vector<bool>(width, true), opStart);
+            break;
+        }
+        if (diverged) continue;
+
+        executionStep++;
+        stats.lockstepSteps++;
+        i++;
+
+        if (limits.maxBubbles && depth > limits.maxBubbles) limitHit = ExecuteStatus::MemoryLimit;
+        if (limitHit) finish(*limitHit);
+    }
+}
+
+LockstepRunner::LockstepRunner(const ExecutionLimits& limits, size_t width) : limits(limits), width(std::max<size_t>(1, width)) {
+}
+
+void LockstepRunner::run(const CompiledProgram& program, const std::vector<std::string>& inputs, const std::function<void(BatchResult&)>& emit, LockstepStats* stats) const {
+    LockstepStats localStats;
+    LockstepStats& groupStats = stats ? *stats : localStats;
+    VmState scalar;
+    scalar.setLimits(limits);
+
+    for (size_t first = 0; first < inputs.size(); first += width) {
+        const size_t count = std::min(width, inputs.size() - first);
+        groupStats.groups++;
+        groupStats.lanes += count;
+
+        Group group(*this, program, inputs, first, count, scalar, groupStats);
+        group.run();
+        for (BatchResult& result : group.results) {
+            emit(result);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "BatchRunner.hpp"
+
+/**
+* @brief What LockstepRunner::run did with its lanes.
+*/
+struct LockstepStats {
+    size_t groups = 0;
+    size_t lanes = 0;
+    size_t lockstepLanes = 0;               // Lanes that ran to their end in lockstep
+    size_t divergedLanes = 0;               // Lanes split off at a conditional the other lanes decided differently
+    size_t scalarLanes = 0;                 // Lanes split off for an instruction the lockstep engine does not run
+    uint64_t lockstepSteps = 0;             // Steps executed once for a whole group
+
+    void print(std::ostream& out) const;
+};
+
+/**
+* @brief Runs one legacy program over many inputs, a group of lanes at a time on one decoded instruction stream.
+* @details The abysses of a group hold simple bubbles only and are stored as structure of arrays, one array of lanes per
+*   depth, so every Awatism is decoded once per group and 4dd, sub, mul and the conditionals run as loops over the lanes.
+*   All abysses of a group have the same depth, warnings depend on the depth only, so lanes never warn in lockstep.
+*   - Lanes a conditional decides differently are split off before it, the smaller side continues on a scalar VmState.
+*   - Before an instruction that would warn or create a double bubble (red, srn, mrg, div), every lane continues on a scalar VmState.
+*   The results are the same as BatchRunner's, the timeout applies to each group instead of each job.
+*   AWA5.0++ programs run on scalar VmStates only.
+*/
+class LockstepRunner {
+public:
+    /**
+    * @param limits The limits of every job.
+    * @param width The lanes of a group.
+    */
+    explicit LockstepRunner(const ExecutionLimits& limits = {}, size_t width = 64);
+
+    /**
+    * @brief Runs the program over every input and emits the results in input order.
+    *
+    * @param program The program of every job.
+    * @param inputs The input of each job.
+    * @param emit Called with each result, in input order.
+    * @param stats Receives what ran in lockstep, may be nullptr.
+    */
+    void run(const CompiledProgram& program, const std::vector<std::string>& inputs, const std::function<void(BatchResult&)>& emit, LockstepStats* stats = nullptr) const;
+
+private:
+    class Group;
+
+    ExecutionLimits limits;
+    size_t width;
+};
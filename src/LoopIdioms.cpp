@@ -0,0 +1,165 @@
+#include "LoopIdioms.hpp"
+#include <algorithm>
+#include <new>
+
+namespace {
+
+/**
+* @brief Reads legacy instructions one after another, each taking its parameter along.
+*/
+struct Cursor {
+    const std::vector<int>& data;
+    size_t i;
+
+    bool next(int op) {
+        if (i >= data.size() || data[i] != op) return false;
+        i++;
+        return true;
+    }
+
+    bool next(int op, int parameter) {
+        if (i + 1 >= data.size() || data[i] != op || data[i + 1] != parameter) return false;
+        i += 2;
+        return true;
+    }
+
+    bool nextParameter(int op, int& parameter) {
+        if (i + 1 >= data.size() || data[i] != op) return false;
+        parameter = data[i + 1];
+        i += 2;
+        return true;
+    }
+};
+
+}
+
+void LoopIdioms::recognize(CompiledProgram& program) {
+    program.loops.clear();
+    if (!program.legacy) return;
+
+    forEachLabel(program.data, 0, [&program](int label, size_t position) {
+        // Only the last definition of a label is jumped back to
+        if (program.lblTable.at(label) != position) return;
+        if (std::optional<LoopIdiom> idiom = match(program, label, position + 1)) {
+            program.loops.emplace(position - 1, std::move(*idiom));
+        }
+    });
+}
+
+std::optional<LoopIdiom> LoopIdioms::match(const CompiledProgram& program, int label, size_t start) {
+    Cursor cursor{ program.data, start };
+    int exitLabel = 0;
+    if (!(cursor.next(blw, 0) && cursor.next(eql) && cursor.nextParameter(jmp, exitLabel) && cursor.next(pop))) return std::nullopt;
+
+    auto exit = program.lblTable.find(exitLabel);
+    if (exit == program.lblTable.end()) return std::nullopt;
+
+    auto decrement = [&program, label](size_t position) {
+        Cursor tail{ program.data, position };
+        return tail.next(blw, 1) && tail.next(sbm, 1) && tail.next(sub) && tail.next(jmp, label);
+    };
+
+    LoopIdiom idiom{ LoopIdiom::Kind::Countdown, exit->second, 7, {} };
+    const size_t body = cursor.i;
+    if (cursor.next(sbm, 1) && cursor.next(sbm, 0) && decrement(cursor.i)) {
+        idiom.kind = LoopIdiom::Kind::Rotation;
+        idiom.iterationSteps += 2;
+        return idiom;
+    }
+
+    cursor.i = body;
+    if (cursor.next(sbm, 2) && cursor.next(mrg) && cursor.next(sbm, 1) && decrement(cursor.i)) {
+        idiom.kind = LoopIdiom::Kind::Accumulation;
+        idiom.iterationSteps += 3;
+        return idiom;
+    }
+
+    // blw 1; sbm 1 is also how the decrement starts, so the decrement is looked for before every push
+    cursor.i = body;
+    while (!decrement(cursor.i)) {
+        LoopIdiom::Push push{ false, 0 };
+        if (cursor.next(dpl)) push.counter = true;
+        else if (!cursor.nextParameter(blw, push.value)) return std::nullopt;
+        if (!cursor.next(sbm, 1)) return std::nullopt;
+
+        idiom.pushes.push_back(push);
+        idiom.iterationSteps += 2;
+    }
+    return idiom;
+}
+
+LoopIdioms::Outcome LoopIdioms::run(const LoopIdiom& idiom, VmState& state, uint64_t maxSteps) {
+    std::vector<Bubble>& bubbleAbyss = state.bubbleAbyss;
+    if (bubbleAbyss.empty() || isDouble(bubbleAbyss.back())) return {};
+
+    // A negative counter never reaches 0
+    const int counter = getInt(bubbleAbyss.back());
+    if (counter < 0 || maxSteps < 3) return {};
+    const uint64_t iterations = static_cast<uint64_t>(counter);
+    if (iterations > (maxSteps - 3) / idiom.iterationSteps) return {};
+
+    // Without enough bubbles under the counter, sbm drops bubbles and mrg warns
+    const size_t below = bubbleAbyss.size() - 1;
+    if (idiom.kind == LoopIdiom::Kind::Rotation && below == 0) return {};
+    if (idiom.kind == LoopIdiom::Kind::Accumulation && below < iterations + 1) return {};
+
+    // Most bubbles are in the abyss at the final test, with the counter, every push and the 0 blown for it.
+    // The bubbles of every merge would have to be counted, so counted accumulations are interpreted.
+    const bool counting = state.limits.maxBubbles != 0;
+    const uint64_t pushed = (idiom.kind == LoopIdiom::Kind::Countdown) ? iterations * idiom.pushes.size() : 0;
+    if (counting && (idiom.kind == LoopIdiom::Kind::Accumulation || state.bubbleCount + pushed + 1 > state.limits.maxBubbles)) return {};
+
+    // Reserved before the abyss is changed. Without a deadline the interpreter would run out of memory on the loop as well,
+    // with one it may time out first.
+    const bool timed = state.deadline != std::chrono::steady_clock::time_point::max();
+    try {
+        bubbleAbyss.reserve(bubbleAbyss.size() + pushed + 1);
+    }
+    catch (const std::bad_alloc&) {
+        if (!timed) throw;
+        return {};
+    }
+
+    bubbleAbyss.pop_back();
+    switch (idiom.kind) {
+    case LoopIdiom::Kind::Countdown: {
+        for (int value = counter; value > 0;) {
+            const int chunkEnd = timed ? std::max(0, value - ClockIterations) : 0;
+            for (; value > chunkEnd; value--) {
+                for (const LoopIdiom::Push& push : idiom.pushes) {
+                    bubbleAbyss.emplace_back(push.counter ? value : push.value);
+                }
+            }
+
+            // Back on the head of the loop with the counter on top, as the interpreter would be after its jmp
+            if (value > 0 && std::chrono::steady_clock::now() >= state.deadline) {
+                const uint64_t done = static_cast<uint64_t>(counter - value);
+                bubbleAbyss.emplace_back(value);
+                if (counting) state.bubbleCount += done * idiom.pushes.size();
+                return { done * idiom.iterationSteps, true };
+            }
+        }
+        break;
+    }
+    case LoopIdiom::Kind::Rotation:
+        std::rotate(bubbleAbyss.begin(), bubbleAbyss.end() - static_cast<ptrdiff_t>(iterations % below), bubbleAbyss.end());
+        break;
+    case LoopIdiom::Kind::Accumulation: {
+        Bubble accumulated = std::move(bubbleAbyss.back());
+        bubbleAbyss.pop_back();
+        for (uint64_t n = 0; n < iterations; n++) {
+            Bubble next = std::move(bubbleAbyss.back());
+            bubbleAbyss.pop_back();
+            accumulated = AwaInterpreter::mergeBubbles(std::move(accumulated), std::move(next));
+        }
+        bubbleAbyss.push_back(std::move(accumulated));
+        break;
+    }
+    }
+
+    // The counter and the 0 blown for the final test are left on top
+    bubbleAbyss.emplace_back(0);
+    bubbleAbyss.emplace_back(0);
+    if (counting) state.bubbleCount += pushed + 1;
+    return { iterations * idiom.iterationSteps + 3, false };
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+
+/**
+* @brief Recognizes common counting loops of legacy programs, so the engine runs them as one native operation.
+* @details Every idiom is the countdown loop
+*   lbl L; blw 0; eql; jmp E; pop; <body>; blw 1; sbm 1; sub; jmp L
+*   on a counter at the top of the abyss, with one of these bodies:
+*   - Countdown: any number of blw <value>; sbm 1 and dpl; sbm 1, pushing values or the counter under the counter.
+*   - Rotation: sbm 1; sbm 0, rotating the abyss under the counter towards the bottom.
+*   - Accumulation: sbm 2; mrg; sbm 1, merging the bubble under the counter with the ones below it.
+*     Followed by a pop of the accumulated double bubble, this reverses the abyss.
+*   The native run leaves the same abyss, step count, bubble count and position as the interpreter, anything it cannot guarantee that for
+*   is interpreted. AWA5.0++ skips into the parameters of the jmp after a conditional, so these loops only exist in legacy programs.
+*/
+class LoopIdioms {
+public:
+    /**
+    * @brief How far a native run got.
+    */
+    struct Outcome {
+        uint64_t steps = 0;         // Steps without the lbl, 0 if the loop has to be interpreted and the state is unchanged
+        bool timedOut = false;      // Stopped at the deadline of the state on the head of the loop, after whole iterations
+    };
+
+    /**
+    * @brief Fills CompiledProgram::loops with the loops matching an idiom.
+    */
+    static void recognize(CompiledProgram& program);
+
+    /**
+    * @brief Runs a recognized loop from its lbl to its exit lbl on the state.
+    * @details A countdown reads the clock every ClockIterations iterations if the state has a deadline.
+    *   Rotations and accumulations take time in the size of the abyss they started with, they are not interrupted.
+    *   A loop the bubble limit would stop is left to the interpreter, so it stops on the same step.
+    *
+    * @param idiom The loop to be run.
+    * @param state The state, the counter at the top of its abyss.
+    * @param maxSteps The most steps the loop may take.
+    */
+    static Outcome run(const LoopIdiom& idiom, VmState& state, uint64_t maxSteps);
+
+    static constexpr int ClockIterations = 1 << 16;
+
+private:
+    static std::optional<LoopIdiom> match(const CompiledProgram& program, int label, size_t start);
+};
@@ -0,0 +1,439 @@
+#include "Optimizer.hpp"
+#include <algorithm>
+
+namespace {
+
+constexpr size_t registerCount = std::tuple_size_v<VmState::Registers>;
+
+bool isRegister(int index) {
+    return index >= 0 && static_cast<size_t>(index) < registerCount;
+}
+
+/**
+* @brief What is known about a register at a point of the program.
+*/
+struct RegisterValue {
+    enum Kind : uint8_t { Unset, Constant, Varying } kind = Unset;     // Unset until a path reaches the point
+    int value = 0;
+
+    bool operator==(const RegisterValue& other) const { return kind == other.kind && (kind != Constant || value == other.value); }
+};
+
+using RegisterState = std::array<RegisterValue, registerCount>;
+
+RegisterValue meet(RegisterValue a, RegisterValue b) {
+    if (a.kind == RegisterValue::Unset) return b;
+    if (b.kind == RegisterValue::Unset) return a;
+    if (a.kind == RegisterValue::Constant && b.kind == RegisterValue::Constant && a.value == b.value) return a;
+    return { RegisterValue::Varying, 0 };
+}
+
+/**
+* @brief Applies the register writes of an instruction, mov loads a constant or copies, pop loads a value off the abyss.
+*/
+void transfer(const std::vector<int>& data, const ControlFlowGraph::Instruction& instruction, RegisterState& registers) {
+    const size_t p = instruction.position;
+    if (instruction.op == mov && instruction.length == 4) {
+        registers[data[p + 2]] = data[p + 1] ? registers[data[p + 3]] : RegisterValue{ RegisterValue::Constant, data[p + 3] };
+    }
+    else if (instruction.op == pop && instruction.length == 2) {
+        registers[data[p + 1]] = { RegisterValue::Varying, 0 };
+    }
+}
+
+/**
+* @brief Returns the slot of the register operand of blw, sbm, srn, jmp or mov, 0 if the instruction reads no register.
+*/
+size_t registerOperand(const std::vector<int>& data, const ControlFlowGraph::Instruction& instruction) {
+    const size_t p = instruction.position;
+    switch (instruction.op) {
+    case blw:
+    case sbm:
+    case srn:
+    case jmp:
+        return (instruction.length == 3 && data[p + 1]) ? p + 2 : 0;
+    case mov:
+        return (instruction.length == 4 && data[p + 1]) ? p + 3 : 0;
+    default:
+        return 0;
+    }
+}
+
+/**
+* @brief Checks that every register written by mov and pop exists, the engine does not check them.
+*/
+bool registersInRange(const std::vector<int>& data, const ControlFlowGraph& cfg) {
+    for (const ControlFlowGraph::Instruction& instruction : cfg.instructions) {
+        const size_t p = instruction.position;
+        if (instruction.op == mov && instruction.length == 4 && (!isRegister(data[p + 2]) || (data[p + 1] && !isRegister(data[p + 3])))) return false;
+        if (instruction.op == pop && instruction.length == 2 && !isRegister(data[p + 1])) return false;
+    }
+    return true;
+}
+
+}
+
+ControlFlowGraph::ControlFlowGraph(const CompiledProgram& program) : byPosition(program.data.size(), -1) {
+    if (program.data.empty()) return;
+
+    decode(program, 0);
+    std::sort(instructions.begin(), instructions.end(), [](const Instruction& a, const Instruction& b) { return a.position < b.position; });
+
+    std::vector<uint8_t> coverage(program.data.size(), 0);
+    for (size_t n = 0; n < instructions.size(); n++) {
+        byPosition[instructions[n].position] = static_cast<ptrdiff_t>(n);
+        for (size_t s = instructions[n].position; s < instructions[n].position + instructions[n].length; s++) {
+            coverage[s] = static_cast<uint8_t>(std::min(coverage[s] + 1, 2));
+        }
+    }
+    for (Instruction& instruction : instructions) {
+        instruction.pinned = std::any_of(coverage.begin() + instruction.position, coverage.begin() + instruction.position + instruction.length, [](uint8_t c) { return c > 1; });
+    }
+
+    // A block continues into the only successor of its last instruction, unless that one is reached from elsewhere too
+    std::vector<size_t> predecessors(instructions.size(), 0);
+    std::vector<bool> leader(instructions.size(), false);
+    for (const Instruction& instruction : instructions) {
+        for (size_t successor : instruction.successors) {
+            ptrdiff_t next = instructionAt(successor);
+            if (next < 0) continue;
+
+            predecessors[next]++;
+            if (instruction.successors.size() != 1 || instruction.op == jmp) leader[next] = true;
+        }
+    }
+
+    const size_t entry = static_cast<size_t>(instructionAt(0));
+    std::vector<size_t> blockOf(instructions.size(), 0);
+    std::vector<size_t> leaders = { entry };
+    for (size_t n = 0; n < instructions.size(); n++) {
+        leader[n] = leader[n] || n == entry || predecessors[n] != 1 || instructions[n].op == lbl;
+        if (leader[n] && n != entry) leaders.push_back(n);
+    }
+
+    for (size_t first : leaders) {
+        size_t last = first;
+        while (instructions[last].successors.size() == 1) {
+            ptrdiff_t next = instructionAt(instructions[last].successors[0]);
+            if (next < 0 || leader[next]) break;
+            last = static_cast<size_t>(next);
+        }
+
+        for (size_t n = first;; n = static_cast<size_t>(instructionAt(instructions[n].successors[0]))) {
+            blockOf[n] = blocks.size();
+            if (n == last) break;
+        }
+        blocks.push_back({ first, last, {} });
+    }
+
+    for (Block& block : blocks) {
+        for (size_t successor : instructions[block.last].successors) {
+            ptrdiff_t next = instructionAt(successor);
+            if (next >= 0) block.successors.push_back(blockOf[next]);
+        }
+    }
+}
+
+ptrdiff_t ControlFlowGraph::instructionAt(size_t position) const {
+    return (position < byPosition.size()) ? byPosition[position] : -1;
+}
+
+void ControlFlowGraph::decode(const CompiledProgram& program, size_t start) {
+    const std::vector<int>& data = program.data;
+    std::vector<size_t> pending = { start };
+
+    // Lengths and successors follow the AWA5.0++ engine, parameters missing at the end of the program are warned about and skipped
+    while (!pending.empty()) {
+        const size_t p = pending.back();
+        pending.pop_back();
+        if (p >= data.size() || byPosition[p] >= 0) continue;
+
+        Instruction instruction{ p, data[p], 1, {}, false };
+        switch (instruction.op) {
+        case blw:
+        case sbm:
+        case srn:
+            if (p + 2 < data.size()) instruction.length = 3;
+            instruction.successors = { p + instruction.length };
+            break;
+        case jmp:
+            if (p + 2 < data.size()) {
+                instruction.length = 3;
+                if (data[p + 1] && isRegister(data[p + 2])) {
+                    // Any label, or the next instruction when the register names none
+                    for (const auto& [label, target] : program.lblTable) {
+                        instruction.successors.push_back(target + 1);
+                    }
+                    instruction.successors.push_back(p + 3);
+                }
+                else {
+                    auto target = program.lblTable.find(data[p + 1] ? 0 : data[p + 2]);
+                    instruction.successors = { (target != program.lblTable.end()) ? target->second + 1 : p + 3 };
+                }
+            }
+            else {
+                instruction.successors = { p + 1 };
+            }
+            break;
+        case pop:
+            // An empty abyss leaves the register to be run as an instruction
+            if (p + 1 < data.size()) {
+                instruction.length = 2;
+                instruction.successors = { p + 2, p + 1 };
+            }
+            else {
+                instruction.successors = { p + 1 };
+            }
+            break;
+        case mov:
+            if (p + 3 < data.size()) instruction.length = 4;
+            instruction.successors = { p + instruction.length };
+            break;
+        case lbl:
+            if (p + 1 < data.size()) instruction.length = 2;
+            instruction.successors = { p + instruction.length };
+            break;
+        case eql:
+        case lss:
+        case gr8:
+            instruction.successors = { p + 1, p + 1 + ((p + 1 < data.size()) ? skippedLength(data[p + 1]) : 1) };
+            break;
+        case trm:
+            break;
+        default:
+            instruction.successors = { p + 1 };
+            break;
+        }
+
+        std::sort(instruction.successors.begin(), instruction.successors.end());
+        instruction.successors.erase(std::unique(instruction.successors.begin(), instruction.successors.end()), instruction.successors.end());
+
+        byPosition[p] = static_cast<ptrdiff_t>(instructions.size());
+        pending.insert(pending.end(), instruction.successors.begin(), instruction.successors.end());
+        instructions.push_back(std::move(instruction));
+    }
+}
+
+void OptimizationReport::print(std::ostream& out) const {
+    if (legacy) {
+        out << "[Optimizer] Legacy programs have no registers, nothing to optimize." << std::endl;
+        return;
+    }
+
+    out << "[Optimizer] " << instructions << " instructions in " << blocks << " blocks, "
+        << specialized() << " of " << registerOperands << " register operands specialized (blw " << blowsSpecialized
+        << ", sbm " << submergesSpecialized << ", srn " << surroundsSpecialized << ", mov " << movesSpecialized
+        << ", jmp " << jumpsResolved << " resolved), " << deadMovesRemoved << " dead mov removed";
+    if (pinned) out << ", " << pinned << " overlapping instructions left alone";
+    out << "." << std::endl;
+}
+
+std::shared_ptr<const CompiledProgram> Optimizer::optimize(std::shared_ptr<const CompiledProgram> program, OptimizationReport& report) {
+    report = {};
+    report.legacy = program->legacy;
+    if (program->legacy) {
+        return program;
+    }
+
+    {
+        ControlFlowGraph cfg(*program);
+        if (!registersInRange(program->data, cfg)) {
+            report.instructions = cfg.instructions.size();
+            report.blocks = cfg.blocks.size();
+            return program;
+        }
+
+        for (const ControlFlowGraph::Instruction& instruction : cfg.instructions) {
+            if (registerOperand(program->data, instruction)) report.registerOperands++;
+        }
+    }
+
+    auto optimized = std::make_shared<CompiledProgram>(*program);
+    // Removing a mov that copies a register can leave the mov loading that register dead too
+    bool changed = false;
+    for (;;) {
+        while (specialize(*optimized, report)) {
+            changed = true;
+        }
+        if (!removeDeadMoves(*optimized, report)) break;
+        changed = true;
+    }
+
+    ControlFlowGraph cfg(*optimized);
+    report.instructions = cfg.instructions.size();
+    report.blocks = cfg.blocks.size();
+    report.pinned = static_cast<size_t>(std::count_if(cfg.instructions.begin(), cfg.instructions.end(), [](const ControlFlowGraph::Instruction& instruction) { return instruction.pinned; }));
+
+    return changed ? optimized : program;
+}
+
+bool Optimizer::specialize(CompiledProgram& program, OptimizationReport& report) {
+    std::vector<int>& data = program.data;
+    ControlFlowGraph cfg(program);
+    if (cfg.blocks.empty()) {
+        return false;
+    }
+
+    // The registers of a fresh VmState are 0
+    std::vector<RegisterState> in(cfg.blocks.size());
+    std::vector<bool> queued(cfg.blocks.size(), false);
+    in[0].fill({ RegisterValue::Constant, 0 });
+
+    std::vector<size_t> worklist = { 0 };
+    queued[0] = true;
+    while (!worklist.empty()) {
+        size_t b = worklist.back();
+        worklist.pop_back();
+        queued[b] = false;
+
+        RegisterState registers = in[b];
+        for (size_t n = cfg.blocks[b].first;; n = static_cast<size_t>(cfg.instructionAt(cfg.instructions[n].successors[0]))) {
+            transfer(data, cfg.instructions[n], registers);
+            if (n == cfg.blocks[b].last) break;
+        }
+
+        for (size_t successor : cfg.blocks[b].successors) {
+            RegisterState merged;
+            for (size_t r = 0; r < registerCount; r++) {
+                merged[r] = meet(in[successor][r], registers[r]);
+            }
+            if (merged != in[successor]) {
+                in[successor] = merged;
+                if (!queued[successor]) {
+                    queued[successor] = true;
+                    worklist.push_back(successor);
+                }
+            }
+        }
+    }
+
+    // Turn register operands holding a constant into immediates, the instructions keep their length
+    bool changed = false;
+    for (const ControlFlowGraph::Block& block : cfg.blocks) {
+        RegisterState registers = in[&block - cfg.blocks.data()];
+        for (size_t n = block.first;; n = static_cast<size_t>(cfg.instructionAt(cfg.instructions[n].successors[0]))) {
+            const ControlFlowGraph::Instruction& instruction = cfg.instructions[n];
+            size_t operand = registerOperand(data, instruction);
+            if (operand && !instruction.pinned) {
+                // sbm, srn and jmp read a missing register as 0, blw blows nothing
+                int index = data[operand];
+                std::optional<int> value;
+                if (isRegister(index) && registers[index].kind == RegisterValue::Constant) value = registers[index].value;
+                else if (!isRegister(index) && instruction.op != blw && instruction.op != mov) value = 0;
+
+                if (value) {
+                    data[instruction.position + 1] = 0;
+                    data[operand] = *value;
+                    changed = true;
+
+                    switch (instruction.op) {
+                    case blw: report.blowsSpecialized++; break;
+                    case sbm: report.submergesSpecialized++; break;
+                    case srn: report.surroundsSpecialized++; break;
+                    case jmp: report.jumpsResolved++; break;
+                    case mov: report.movesSpecialized++; break;
+                    }
+                }
+            }
+
+            transfer(data, instruction, registers);
+            if (n == block.last) break;
+        }
+    }
+
+    return changed;
+}
+
+bool Optimizer::removeDeadMoves(CompiledProgram& program, OptimizationReport& report) {
+    std::vector<int>& data = program.data;
+    ControlFlowGraph cfg(program);
+    if (cfg.blocks.empty()) {
+        return false;
+    }
+
+    auto uses = [&data](const ControlFlowGraph::Instruction& instruction) -> uint32_t {
+        size_t operand = registerOperand(data, instruction);
+        return (operand && isRegister(data[operand])) ? 1u << data[operand] : 0;
+    };
+    auto kills = [&data](const ControlFlowGraph::Instruction& instruction) -> uint32_t {
+        return (instruction.op == mov && instruction.length == 4) ? 1u << data[instruction.position + 2] : 0;
+    };
+    auto liveBefore = [&](const ControlFlowGraph::Instruction& instruction, uint32_t live) {
+        return (live & ~kills(instruction)) | uses(instruction);
+    };
+
+    // Backward liveness, nothing is read after the program ends, pop may find the abyss empty and does not kill
+    std::vector<std::vector<size_t>> blockInstructions(cfg.blocks.size());
+    for (size_t b = 0; b < cfg.blocks.size(); b++) {
+        for (size_t n = cfg.blocks[b].first;; n = static_cast<size_t>(cfg.instructionAt(cfg.instructions[n].successors[0]))) {
+            blockInstructions[b].push_back(n);
+            if (n == cfg.blocks[b].last) break;
+        }
+    }
+
+    std::vector<uint32_t> liveIn(cfg.blocks.size(), 0), liveOut(cfg.blocks.size(), 0);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t b = cfg.blocks.size(); b-- > 0;) {
+            uint32_t live = 0;
+            for (size_t successor : cfg.blocks[b].successors) {
+                live |= liveIn[successor];
+            }
+            liveOut[b] = live;
+            for (auto n = blockInstructions[b].rbegin(); n != blockInstructions[b].rend(); ++n) {
+                live = liveBefore(cfg.instructions[*n], live);
+            }
+            if (live != liveIn[b]) {
+                liveIn[b] = live;
+                changed = true;
+            }
+        }
+    }
+
+    // A removed mov must not be skipped by a conditional or hold the position of a label, everything else only shifts
+    std::vector<bool> removed(data.size() + 1, false);
+    bool any = false;
+    for (size_t b = 0; b < cfg.blocks.size(); b++) {
+        uint32_t live = liveOut[b];
+        for (auto n = blockInstructions[b].rbegin(); n != blockInstructions[b].rend(); ++n) {
+            const ControlFlowGraph::Instruction& instruction = cfg.instructions[*n];
+            const size_t p = instruction.position;
+            if (instruction.op == mov && instruction.length == 4 && !instruction.pinned) {
+                bool selfCopy = data[p + 1] && data[p + 2] == data[p + 3];
+                bool dead = !(live & kills(instruction)) || selfCopy;
+
+                ptrdiff_t previous = p ? cfg.instructionAt(p - 1) : -1;
+                bool skipped = previous >= 0 && (data[p - 1] == eql || data[p - 1] == lss || data[p - 1] == gr8);
+                bool labelled = std::any_of(program.lblTable.begin(), program.lblTable.end(), [p](const auto& entry) { return entry.second >= p && entry.second < p + 4; });
+
+                if (dead && !skipped && !labelled) {
+                    std::fill(removed.begin() + p, removed.begin() + p + 4, true);
+                    report.deadMovesRemoved++;
+                    any = true;
+                    continue;
+                }
+            }
+            live = liveBefore(instruction, live);
+        }
+    }
+
+    if (!any) {
+        return false;
+    }
+
+    std::vector<size_t> newPosition(data.size() + 1, 0);
+    std::vector<int> compacted;
+    compacted.reserve(data.size());
+    for (size_t s = 0; s < data.size(); s++) {
+        newPosition[s] = compacted.size();
+        if (!removed[s]) compacted.push_back(data[s]);
+    }
+    newPosition[data.size()] = compacted.size();
+
+    for (auto& [label, position] : program.lblTable) {
+        position = newPosition[position];
+    }
+    data = std::move(compacted);
+
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+
+/**
+* @brief Control-flow graph of an AWA5.0++ program, decoded the way the engine steps over it.
+* @details Instructions are decoded from the start and from every position execution can continue at, so an instruction
+*   overlapping another one (a conditional skipping into the parameters of a jmp, a pop on an empty abyss running its register
+*   as an instruction) is decoded as well. Basic blocks are split at lbl, after jmp and the conditional Awatisms, and wherever control flow joins.
+*/
+class ControlFlowGraph {
+public:
+    struct Instruction {
+        size_t position;
+        int op;
+        size_t length;                          // Slots of the instruction and its parameters
+        std::vector<size_t> successors;         // Positions executed next, positions past the end of the program end it
+        bool pinned;                            // Shares slots with another instruction, so it must not be changed
+    };
+
+    struct Block {
+        size_t first, last;                     // Indices into instructions
+        std::vector<size_t> successors;         // Indices into blocks
+    };
+
+    explicit ControlFlowGraph(const CompiledProgram& program);
+
+    std::vector<Instruction> instructions;      // Sorted by position
+    std::vector<Block> blocks;                  // blocks[0] starts at the entry
+
+    /**
+    * @brief Returns the index of the instruction starting at a position, -1 if none does.
+    */
+    ptrdiff_t instructionAt(size_t position) const;
+
+private:
+    void decode(const CompiledProgram& program, size_t position);
+
+    std::vector<ptrdiff_t> byPosition;
+};
+
+/**
+* @brief What Optimizer::optimize changed.
+*/
+struct OptimizationReport {
+    bool legacy = false;
+    size_t instructions = 0;
+    size_t blocks = 0;
+    size_t registerOperands = 0;                // blw, sbm, srn, jmp and mov operands read from a register
+    size_t blowsSpecialized = 0;
+    size_t submergesSpecialized = 0;
+    size_t surroundsSpecialized = 0;
+    size_t jumpsResolved = 0;
+    size_t movesSpecialized = 0;
+    size_t deadMovesRemoved = 0;
+    size_t pinned = 0;                          // Instructions left alone because they overlap others
+
+    size_t specialized() const { return blowsSpecialized + submergesSpecialized + surroundsSpecialized + jumpsResolved + movesSpecialized; }
+
+    void print(std::ostream& out) const;
+};
+
+/**
+* @brief Specializes AWA5.0++ programs on the registers of the Bubble Pond.
+* @details Propagates the constants registers are loaded with by mov over the control-flow graph, starting from the zeroed registers
+*   of a fresh VmState. Register operands holding a constant become immediates, which also resolves jmp by register statically,
+*   and mov whose register is not read again are removed. The output is the same, the step count drops by the removed mov.
+*   Legacy programs have no registers and are returned unchanged.
+*/
+class Optimizer {
+public:
+    /**
+    * @brief Optimizes a program for runs on a fresh VmState, it must not be resumed from a state of the original program.
+    *
+    * @param program The program to be optimized.
+    * @param report Receives what was changed.
+    *
+    * @return The optimized program, the program itself if nothing changed.
+    */
+    static std::shared_ptr<const CompiledProgram> optimize(std::shared_ptr<const CompiledProgram> program, OptimizationReport& report);
+
+private:
+    static bool specialize(CompiledProgram& program, OptimizationReport& report);
+    static bool removeDeadMoves(CompiledProgram& program, OptimizationReport& report);
+};
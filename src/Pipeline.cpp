@@ -0,0 +1,288 @@
+#include "Pipeline.hpp"
+#include "LoopIdioms.hpp"
+#include "SpscQueue.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr size_t BlockSize = 16 << 10;          // Characters decoded between checks for a stop
+constexpr size_t FirstChunk = 256;              // Values, the chunks double up to LastChunk so the first one is ready early
+constexpr size_t LastChunk = 64 << 10;
+
+struct DecodedChunk {
+    std::vector<int> data;
+    bool legacy = false;
+    bool last = false;
+};
+
+/**
+* @brief The SpscQueue of chunks between the decoder and the executing thread, whichever side has to wait sleeps.
+*/
+class ChunkChannel {
+public:
+    /**
+    * @return false if asked to stop before there was room for the chunk.
+    */
+    bool push(DecodedChunk& chunk, std::stop_token stop) {
+        if (!queue.tryPush(chunk)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!changed.wait(lock, stop, [&] { return queue.tryPush(chunk); })) return false;
+        }
+        wake();
+        return true;
+    }
+
+    void pop(DecodedChunk& chunk) {
+        if (!queue.tryPop(chunk)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return queue.tryPop(chunk); });
+        }
+        wake();
+    }
+
+    bool tryPop(DecodedChunk& chunk) {
+        if (!queue.tryPop(chunk)) return false;
+        wake();
+        return true;
+    }
+
+private:
+    void wake() {
+        // Taking the mutex makes sure the other side is either waiting already or still going to look at the queue
+        { std::lock_guard<std::mutex> lock(mutex); }
+        changed.notify_one();
+    }
+
+    SpscQueue<DecodedChunk> queue{ 64 };
+    std::mutex mutex;
+    std::condition_variable_any changed;        // Wakes up on a stop request as well
+};
+
+/**
+* @brief The last line that is not blank without its leading and trailing blanks, like the command line filters Awalang.
+*/
+std::string_view lastLine(std::string_view text) {
+    const char* blanks = " \t\r\n";
+    size_t end = text.find_last_not_of(blanks);
+    if (end == std::string_view::npos) return {};
+
+    size_t start = text.rfind('\n', end);
+    start = text.find_first_not_of(blanks, (start == std::string_view::npos) ? 0 : start + 1);
+    return text.substr(start, end + 1 - start);
+}
+
+/**
+* @brief decodeAwalang on text arriving in blocks, decoding only as far as the text so far decides.
+*/
+class AwalangStream {
+public:
+    /**
+    * @brief Appends text and calls emit(value, instruction) for every value it decides, like decodeAwalang.
+    */
+    template <typename Emit>
+    void feed(std::string_view block, Emit&& emit) {
+        text.append(block);
+        decode(false, emit);
+
+        // Only the characters from index on are read again
+        if (index - base > (1 << 20)) {
+            text.erase(0, index - base);
+            base = index;
+        }
+    }
+
+    /**
+    * @brief Decodes the rest, the text has ended.
+    */
+    template <typename Emit>
+    void finish(Emit&& emit) {
+        decode(true, emit);
+    }
+
+    bool legacy = false;
+
+private:
+    enum class Phase { Header, Start, Bits, Done };
+
+    bool matches(size_t position, std::string_view token) const {
+        return text.compare(position - base, token.size(), token) == 0;
+    }
+
+    template <typename Emit>
+    void decode(bool final, Emit&& emit) {
+        const size_t size = base + text.size();
+
+        if (phase == Phase::Header) {
+            if (final && size < 6) {
+                phase = Phase::Done;
+                return;
+            }
+
+            // The header has to start more than 6 characters before the end
+            for (; index + 6 < size; index++) {
+                if (matches(index, "awawa ")) {
+                    legacy = false;
+                    index += 5;
+                    phase = Phase::Start;
+                    break;
+                }
+                if (matches(index, "awa ")) {
+                    legacy = true;
+                    index += 3;
+                    phase = Phase::Start;
+                    break;
+                }
+            }
+
+            if (phase == Phase::Header) {
+                if (!final) return;
+
+                // Without a header, the last 6 characters are decoded as AWA5.0++
+                legacy = false;
+                phase = Phase::Start;
+            }
+        }
+
+        if (phase == Phase::Start) {
+            if (index + (legacy ? 3 : 5) >= size) {
+                if (final) phase = Phase::Done;
+                return;
+            }
+            decoder = AwatalkDecoder(legacy);
+            phase = Phase::Bits;
+        }
+
+        if (phase == Phase::Bits) {
+            // A position is decided once 3 characters follow it, at the end the bounds of decodeAwalang apply
+            const size_t end = final ? size - 1 : ((size > 3) ? size - 3 : 0);
+            int value = 0;
+            while (index < end) {
+                int bit;
+                if (matches(index, "wa")) {
+                    bit = 1;
+                    index += 2;
+                }
+                else if (index + 3 < size && matches(index, " awa")) {
+                    bit = 0;
+                    index += 4;
+                }
+                else {
+                    index++;
+                    continue;
+                }
+
+                bool instruction = decoder.readingInstruction();
+                if (decoder.push(bit, value)) emit(value, instruction);
+            }
+
+            if (final) phase = Phase::Done;
+        }
+    }
+
+    std::string text;
+    size_t base = 0;                            // Position of text[0] in the whole text
+    size_t index = 0;
+    Phase phase = Phase::Header;
+    AwatalkDecoder decoder{ false };
+};
+
+/**
+* @brief Groups decoded values into chunks the engine can run up to their end.
+*/
+class ChunkWriter {
+public:
+    ChunkWriter(ChunkChannel& channel, std::stop_token stop) : channel(channel), stop(stop) {}
+
+    void add(int value, bool instruction, bool legacy) {
+        if (instruction) {
+            if (previous != eql && previous != lss && previous != gr8) boundary = values.size();
+            previous = value;
+        }
+        values.push_back(value);
+
+        if (boundary >= target) {
+            send(boundary, legacy, false);
+            target = std::min(target * 2, LastChunk);
+        }
+    }
+
+    /**
+    * @brief Sends everything that is left, the program ends with it.
+    */
+    void close(bool legacy) {
+        send(values.size(), legacy, true);
+    }
+
+private:
+    void send(size_t count, bool legacy, bool last) {
+        DecodedChunk chunk{ std::vector<int>(values.begin(), values.begin() + count), legacy, last };
+        values.erase(values.begin(), values.begin() + count);
+        boundary = 0;
+        channel.push(chunk, stop);
+    }
+
+    ChunkChannel& channel;
+    std::stop_token stop;
+    std::vector<int> values;
+    size_t boundary = 0;                        // Values before the last instruction a chunk may end in front of
+    size_t target = FirstChunk;
+    int previous = -1;
+};
+
+void decode(std::stop_token stop, std::string_view awalang, bool filter, ChunkChannel& channel) {
+    std::string_view source = filter ? lastLine(awalang) : awalang;
+    AwalangStream stream;
+    ChunkWriter writer(channel, stop);
+    auto emit = [&](int value, bool instruction) { writer.add(value, instruction, stream.legacy); };
+
+    std::string filtered;
+    for (size_t offset = 0; offset < source.size(); offset += BlockSize) {
+        if (stop.stop_requested()) return;
+
+        std::string_view block = source.substr(offset, BlockSize);
+        if (filter) {
+            filtered.clear();
+            for (char c : block) {
+                if (c == 'a' || c == 'w' || c == ' ') filtered += c;
+            }
+            block = filtered;
+        }
+        stream.feed(block, emit);
+    }
+
+    stream.finish(emit);
+    writer.close(stream.legacy);
+}
+
+}
+
+ExecuteStatus Pipeline::run(std::string_view awalang, VmState& state, const VmIo& io, bool filter) {
+    ChunkChannel channel;
+    // Asked to stop and joined however the execution returns
+    std::jthread decoder(decode, awalang, filter, std::ref(channel));
+
+    CompiledProgram program;
+    program.complete = false;
+    ExecuteStatus status;
+    do {
+        // Waits for one chunk, then takes whatever else is decoded already
+        DecodedChunk chunk;
+        if (!program.complete) channel.pop(chunk);
+        while (!program.complete) {
+            program.data.insert(program.data.end(), chunk.data.begin(), chunk.data.end());
+            program.legacy = chunk.legacy;
+            if (chunk.last) {
+                program.complete = true;
+                forEachLabel(program.data, 0, [&program](int label, size_t position) { program.lblTable[label] = position; });
+                LoopIdioms::recognize(program);
+            }
+            if (!channel.tryPop(chunk)) break;
+        }
+
+        status = AwaInterpreter::execute(program, state, io);
+    } while (status == ExecuteStatus::WaitingForCode);
+
+    return status;
+}
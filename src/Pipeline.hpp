@@ -0,0 +1,25 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+
+/**
+* @brief Decodes Awalang on its own thread while the calling thread executes the instructions decoded so far.
+* @details The decoder hands over chunks of decoded instructions through an SpscQueue, starting small so the first
+*   instruction runs almost at once. Whichever side has to wait for the other sleeps. A chunk never ends within an instruction or right after a conditional,
+*   whose skip depends on the instruction following it. A later lbl may still redefine a label,
+*   so every jmp waits until the whole program is decoded, see ExecuteStatus::WaitingForCode.
+*   The execution is the same as that of AwaInterpreter::compile(awalang).
+*/
+class Pipeline {
+public:
+    /**
+    * @brief Decodes and executes Awalang until the execution ends, every read has to find its input ready.
+    *
+    * @param awalang The Awalang code, must stay valid until the call returns.
+    * @param state The state to execute on.
+    * @param io The input, output and warning sinks of the execution.
+    * @param filter Keep only the last line that is not blank and the characters a, w and space of it first, like the command line does.
+    *
+    * @return Why the execution returned, never ExecuteStatus::WaitingForCode.
+    */
+    static ExecuteStatus run(std::string_view awalang, VmState& state, const VmIo& io, bool filter = false);
+};
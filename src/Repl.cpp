@@ -0,0 +1,214 @@
+#include "Repl.hpp"
+#include "Awabler.hpp"
+#include <algorithm>
+
+/**
+* @brief Warning sink forwarding every warning and noticing undefined instructions, which the Awabler turns into trm.
+*/
+class UndefinedInstructionCheck : public WarningSink {
+public:
+    explicit UndefinedInstructionCheck(WarningSink& next) : next(next) {}
+
+    void warn(const Warning& warning) override {
+        found |= warning.code == WarningCode::UndefinedInstruction;
+        next.warn(warning);
+    }
+
+    WarningSink& next;
+    bool found = false;
+};
+
+static double microseconds(std::chrono::nanoseconds duration) {
+    return duration.count() / 1000.0;
+}
+
+void Repl::LineOutput::write(std::string_view text) {
+    if (text.empty()) {
+        return;
+    }
+
+    os.write(text.data(), static_cast<std::streamsize>(text.size()));
+    atLineStart = text.back() == '\n';
+}
+
+void Repl::LineOutput::endLine() {
+    if (!atLineStart) {
+        os << '\n';
+        atLineStart = true;
+    }
+}
+
+Repl::Repl(const std::string& input, const ExecutionLimits& limits, WarningSink& warnings) : input(input), warnings(warnings), limits(limits) {
+    program.legacy = Awabler::legacy;
+    state.recordProfile = true;
+}
+
+int Repl::run(std::istream& in, std::ostream& out, bool prompt) {
+    if (prompt) {
+        out << "AWA5.0 " << (program.legacy ? "(legacy) " : "") << "interactive mode, enter Awably or :help." << std::endl;
+    }
+
+    std::string line;
+    while (true) {
+        if (prompt) out << "awa> " << std::flush;
+        if (!std::getline(in, line)) break;
+
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty()) continue;
+
+        if (line[0] == ':') {
+            if (!command(line, out)) break;
+        }
+        else {
+            execute(line, out);
+        }
+    }
+
+    if (prompt) out << std::endl;
+    return 0;
+}
+
+void Repl::execute(const std::string& line, std::ostream& out) {
+    if (state.terminated) {
+        out << "[Repl] The program has terminated, use :reset to start over." << std::endl;
+        return;
+    }
+
+    // A line with an undefined instruction is taken back instead of terminating the session
+    const size_t start = program.data.size();
+    std::optional<std::map<int, size_t>> labels;
+    if (line.find("lbl") != std::string::npos) labels = program.lblTable;
+
+    UndefinedInstructionCheck check(warnings);
+    WarningSink* previousWarnings = Awabler::warnings;
+    Awabler::warnings = &check;
+
+    auto begin = std::chrono::steady_clock::now();
+    AwaInterpreter::appendAwably(program, line);
+    auto compiled = std::chrono::steady_clock::now();
+
+    Awabler::warnings = previousWarnings;
+    if (check.found) {
+        program.data.resize(start);
+        if (labels) program.lblTable = std::move(*labels);
+        out << "[Repl] Line ignored." << std::endl;
+        return;
+    }
+
+    // Limits apply to each line on its own
+    ExecutionLimits lineLimits = limits;
+    lineLimits.maxSteps = limits.maxSteps ? state.executionStep + limits.maxSteps : 0;
+    state.setLimits(lineLimits);
+
+    const uint64_t firstStep = state.executionStep;
+    LineOutput output(out);
+    ExecuteStatus status = AwaInterpreter::execute(program, state, { input, output, warnings });
+    auto executed = std::chrono::steady_clock::now();
+    output.endLine();
+
+    last = { compiled - begin, executed - compiled, state.executionStep - firstStep };
+    total.compile += last.compile;
+    total.execute += last.execute;
+    total.steps += last.steps;
+    lines++;
+
+    if (status == ExecuteStatus::StepLimit || status == ExecuteStatus::MemoryLimit || status == ExecuteStatus::Timeout) {
+        // The rest of the program is skipped, so the next line starts after it
+        out << "[Repl] Error: Execution stopped on step " << state.executionStep << ", " << describe(status) << "." << std::endl;
+        state.pc = program.data.size();
+    }
+    else if (status == ExecuteStatus::Terminated) {
+        out << "[Repl] Terminated on step " << state.executionStep << "." << std::endl;
+    }
+}
+
+bool Repl::command(const std::string& line, std::ostream& out) {
+    if (line == ":stack") {
+        printStack(out);
+    }
+    else if (line == ":regs") {
+        printRegisters(out);
+    }
+    else if (line == ":time") {
+        printTime(out);
+    }
+    else if (line == ":profile") {
+        printProfile(out);
+    }
+    else if (line == ":reset") {
+        reset();
+    }
+    else if (line == ":quit" || line == ":q") {
+        return false;
+    }
+    else if (line == ":help") {
+        out << ":stack     Print the abyss, bottom to top" << std::endl;
+        out << ":regs      Print the pond" << std::endl;
+        out << ":time      Print the compile and execution time of the last line and of the session" << std::endl;
+        out << ":profile   Print the executed steps per instruction" << std::endl;
+        out << ":reset     Clear the program and the VM" << std::endl;
+        out << ":quit      Leave interactive mode" << std::endl;
+    }
+    else {
+        out << "[Repl] Unknown command " << line << ", see :help." << std::endl;
+    }
+
+    return true;
+}
+
+void Repl::printStack(std::ostream& out) const {
+    if (state.bubbleAbyss.empty()) {
+        out << "(empty)" << std::endl;
+        return;
+    }
+
+    std::string text;
+    for (const Bubble& bubble : state.bubbleAbyss) {
+        if (!text.empty()) text += ' ';
+        formatBubble(bubble, text);
+    }
+    out << text << std::endl;
+}
+
+void Repl::printRegisters(std::ostream& out) const {
+    for (size_t r = 0; r < state.bubblePond.size(); r++) {
+        out << "r" << r << "=" << state.bubblePond[r] << ((r % 8 == 7) ? "\n" : ", ");
+    }
+    out << std::flush;
+}
+
+void Repl::printTime(std::ostream& out) const {
+    out << std::fixed << std::setprecision(1);
+    out << "Last line: compile " << microseconds(last.compile) << " us, execute " << microseconds(last.execute) << " us, " << last.steps << " steps" << std::endl;
+    out << "Session:   compile " << microseconds(total.compile) << " us, execute " << microseconds(total.execute) << " us, " << total.steps << " steps in " << lines << " lines" << std::endl;
+    out << std::defaultfloat;
+}
+
+void Repl::printProfile(std::ostream& out) const {
+    std::vector<std::pair<uint64_t, size_t>> counts;
+    for (size_t op = 0; op < state.profile.size(); op++) {
+        if (state.profile[op]) counts.push_back({ state.profile[op], op });
+    }
+    std::sort(counts.rbegin(), counts.rend());
+
+    const uint64_t steps = std::max<uint64_t>(1, state.executionStep);
+    out << std::fixed << std::setprecision(1);
+    for (const auto& [count, op] : counts) {
+        out << std::left << std::setw(10) << awatismName(static_cast<int>(op)) << std::right << std::setw(14) << count << std::setw(7) << 100.0 * count / steps << "%" << std::endl;
+    }
+
+    const double seconds = std::chrono::duration<double>(total.execute).count();
+    out << std::left << std::setw(10) << "total" << std::right << std::setw(14) << state.executionStep;
+    if (seconds > 0) out << "   " << std::setprecision(0) << total.steps / seconds << " steps/s";
+    out << std::endl << std::defaultfloat;
+}
+
+void Repl::reset() {
+    program.data.clear();
+    program.lblTable.clear();
+    state.reset();
+    last = {};
+    total = {};
+    lines = 0;
+}
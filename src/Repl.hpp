@@ -0,0 +1,69 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+#include <chrono>
+
+/**
+* @brief Interactive Awably session on one live VM.
+* @details Every entered line is appended to the program and executed from where the previous line stopped,
+*   the abyss and the pond persist between lines. Lines are compiled against the existing label table,
+*   so a line costs time in proportion to its own length. Lines starting with ':' are commands, see :help.
+*/
+class Repl {
+public:
+    /**
+    * @param input The input of every read.
+    * @param limits The limits of each line, the steps and the timeout count from the start of the line.
+    * @param warnings The sink receiving the warnings.
+    */
+    Repl(const std::string& input, const ExecutionLimits& limits, WarningSink& warnings);
+
+    /**
+    * @brief Reads lines until the end of the input or :quit.
+    *
+    * @param in The stream to read lines from.
+    * @param out The stream receiving the output of the program and of the commands.
+    * @param prompt Whether to write a prompt before each line.
+    *
+    * @return The exit code.
+    */
+    int run(std::istream& in, std::ostream& out, bool prompt);
+
+private:
+    /**
+    * @brief Output sink remembering whether the output ends with a newline, so the prompt starts on its own line.
+    */
+    class LineOutput : public OutputSink {
+    public:
+        explicit LineOutput(std::ostream& os) : os(os) {}
+
+        void write(std::string_view text) override;
+        void endLine();
+
+    private:
+        std::ostream& os;
+        bool atLineStart = true;
+    };
+
+    void execute(const std::string& line, std::ostream& out);
+    bool command(const std::string& line, std::ostream& out);
+    void printStack(std::ostream& out) const;
+    void printRegisters(std::ostream& out) const;
+    void printTime(std::ostream& out) const;
+    void printProfile(std::ostream& out) const;
+    void reset();
+
+    CompiledProgram program;
+    VmState state;
+    StringInput input;
+    WarningSink& warnings;
+    ExecutionLimits limits;
+
+    struct Timing {
+        std::chrono::nanoseconds compile{ 0 };
+        std::chrono::nanoseconds execute{ 0 };
+        uint64_t steps = 0;
+    };
+    Timing last;
+    Timing total;
+    uint64_t lines = 0;
+};
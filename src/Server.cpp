@@ -0,0 +1,395 @@
+#include "Server.hpp"
+#include "Varint.hpp"
+#include <cstring>
+#include <sstream>
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+uint64_t lower(uint64_t requested, uint64_t highest) {
+    if (highest == 0) return requested;
+    return (requested == 0) ? highest : std::min(requested, highest);
+}
+
+#ifndef _WIN32
+bool fillAddress(const std::string& path, sockaddr_un& address) {
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "[Server] Error: The socket path " << path << " is too long." << std::endl;
+        return false;
+    }
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t got = ::recv(fd, data, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+#endif
+
+}
+
+std::string ServeProtocol::encode(const ServeRequest& request) {
+    std::string out;
+    const uint64_t flags = (request.isAwalang ? (*request.isAwalang ? 3 : 1) : 0) | (request.legacy ? 4 : 0);
+    putVarint(out, flags);
+    putVarint(out, request.programId);
+    putBytes(out, request.code);
+    putBytes(out, request.input);
+    putVarint(out, request.maxSteps);
+    putVarint(out, request.maxBubbles);
+    putVarint(out, request.timeoutMs);
+    return out;
+}
+
+std::string ServeProtocol::encode(const ServeResponse& response) {
+    std::string out;
+    putVarint(out, static_cast<uint64_t>(response.result));
+    putVarint(out, response.programId);
+    putVarint(out, static_cast<uint64_t>(response.status));
+    putVarint(out, response.steps);
+    putBytes(out, response.output);
+    putBytes(out, response.warnings);
+    return out;
+}
+
+bool ServeProtocol::decode(std::string_view payload, ServeRequest& request) {
+    VarintReader reader{ payload };
+    const uint64_t flags = reader.varint();
+    request.isAwalang = (flags & 1) ? std::optional<bool>((flags & 2) != 0) : std::nullopt;
+    request.legacy = (flags & 4) != 0;
+    request.programId = reader.varint();
+    request.code = reader.lengthPrefixed();
+    request.input = reader.lengthPrefixed();
+    request.maxSteps = reader.varint();
+    request.maxBubbles = reader.varint();
+    request.timeoutMs = reader.varint();
+    return reader.done() && flags < 8;
+}
+
+bool ServeProtocol::decode(std::string_view payload, ServeResponse& response) {
+    VarintReader reader{ payload };
+    const uint64_t result = reader.varint();
+    response.programId = reader.varint();
+    const uint64_t status = reader.varint();
+    response.steps = reader.varint();
+    response.output = reader.lengthPrefixed();
+    response.warnings = reader.lengthPrefixed();
+    response.result = static_cast<ServeResponse::Result>(result);
+    response.status = static_cast<ExecuteStatus>(status);
+    return reader.done() && result <= static_cast<uint64_t>(ServeResponse::Result::Failed) && status <= static_cast<uint64_t>(ExecuteStatus::WaitingForCode);
+}
+
+bool ServeProtocol::readFrame(int fd, std::string& payload) {
+#ifndef _WIN32
+    unsigned char header[4];
+    if (!readAll(fd, reinterpret_cast<char*>(header), sizeof(header))) return false;
+
+    const uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<uint32_t>(header[3]) << 24);
+    if (size > MaxFrame) return false;
+
+    payload.resize(size);
+    return readAll(fd, payload.data(), size);
+#else
+    return false;
+#endif
+}
+
+bool ServeProtocol::writeFrame(int fd, std::string_view payload) {
+#ifndef _WIN32
+    if (payload.size() > MaxFrame) return false;
+
+    const uint32_t size = static_cast<uint32_t>(payload.size());
+    char header[4] = { static_cast<char>(size), static_cast<char>(size >> 8), static_cast<char>(size >> 16), static_cast<char>(size >> 24) };
+    iovec parts[2] = { { header, sizeof(header) }, { const_cast<char*>(payload.data()), payload.size() } };
+    msghdr message{};
+    message.msg_iov = parts;
+    message.msg_iovlen = 2;
+
+    // MSG_NOSIGNAL, a client hanging up must not end the server with SIGPIPE
+    while (message.msg_iovlen > 0) {
+        ssize_t sent = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+
+        while (message.msg_iovlen > 0 && static_cast<size_t>(sent) >= message.msg_iov->iov_len) {
+            sent -= static_cast<ssize_t>(message.msg_iov->iov_len);
+            message.msg_iov++;
+            message.msg_iovlen--;
+        }
+        if (message.msg_iovlen > 0) {
+            message.msg_iov->iov_base = static_cast<char*>(message.msg_iov->iov_base) + sent;
+            message.msg_iov->iov_len -= static_cast<size_t>(sent);
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t ProgramCache::key(const ServeRequest& request) {
+    const uint64_t flags = (request.isAwalang ? (*request.isAwalang ? 3 : 1) : 0) | (request.legacy ? 4 : 0);
+    const uint64_t id = static_cast<uint64_t>(std::hash<std::string_view>{}(request.code)) ^ ((flags + 1) * 0x9E3779B97F4A7C15ull);
+    return id ? id : 1;
+}
+
+std::shared_ptr<const CompiledProgram> ProgramCache::find(uint64_t id, const std::string* code) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(id);
+    if (it == index.end() || (code && it->second->code != *code)) return nullptr;
+
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->program;
+}
+
+void ProgramCache::insert(uint64_t id, std::string code, std::shared_ptr<const CompiledProgram> program) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(id);
+    if (it != index.end()) {
+        // Another worker compiled it meanwhile, or the code collided with an older program
+        it->second->code = std::move(code);
+        it->second->program = std::move(program);
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    entries.push_front({ id, std::move(code), std::move(program) });
+    index[id] = entries.begin();
+    if (entries.size() > capacity) {
+        index.erase(entries.back().id);
+        entries.pop_back();
+    }
+}
+
+size_t ProgramCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+Server::Server(std::string path, Compiler compile, unsigned int threadCount, const ExecutionLimits& limits, size_t cacheSize)
+    : path(std::move(path)), compile(std::move(compile)), threadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency())),
+    limits(limits), cache(cacheSize) {
+}
+
+Server::~Server() {
+#ifndef _WIN32
+    if (listener >= 0) {
+        ::close(listener);
+        ::unlink(path.c_str());
+    }
+#endif
+}
+
+bool Server::listen() {
+#ifndef _WIN32
+    sockaddr_un address;
+    if (!fillAddress(path, address)) return false;
+
+    // A socket nobody accepts on is left over from a server that ended
+    int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        ::close(probe);
+        std::cerr << "[Server] Error: Another server is listening on " << path << "." << std::endl;
+        return false;
+    }
+    if (probe >= 0) ::close(probe);
+    ::unlink(path.c_str());
+
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 128) != 0) {
+        std::cerr << "[Server] Error: Unable to listen on " << path << ", " << std::strerror(errno) << "." << std::endl;
+        if (listener >= 0) ::close(listener);
+        listener = -1;
+        return false;
+    }
+    return true;
+#else
+    std::cerr << "[Server] Error: Serving needs Unix domain sockets, which this build does not support." << std::endl;
+    return false;
+#endif
+}
+
+void Server::run(const std::atomic<bool>& stop) {
+#ifndef _WIN32
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threadCount; t++) {
+        workers.emplace_back(&Server::serve, this);
+    }
+
+    // Polls, so a stop is noticed within 100 ms even without connections
+    pollfd listening{ listener, POLLIN, 0 };
+    while (!stop) {
+        if (::poll(&listening, 1, 100) <= 0) continue;
+
+        int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) continue;
+
+        timeval idle{ static_cast<time_t>(IdleTimeout.count()), 0 };
+        ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+        ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &idle, sizeof(idle));
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            pending.push_back(connection);
+        }
+        queueReady.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+        for (int connection : active) {
+            ::shutdown(connection, SHUT_RDWR);
+        }
+    }
+    queueReady.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (int connection : pending) {
+        ::close(connection);
+    }
+    pending.clear();
+    ::close(listener);
+    ::unlink(path.c_str());
+    listener = -1;
+#endif
+}
+
+void Server::serve() {
+#ifndef _WIN32
+    VmState state;
+    std::string payload;
+    while (true) {
+        int connection;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) return;
+
+            connection = pending.front();
+            pending.pop_front();
+            active.insert(connection);
+        }
+
+        ServeRequest request;
+        while (ServeProtocol::readFrame(connection, payload)) {
+            ServeResponse response;
+            if (!ServeProtocol::decode(payload, request)) {
+                response.result = ServeResponse::Result::Failed;
+                response.warnings = "[Server] Error: Malformed request.\n";
+            }
+            else {
+                try {
+                    response = handle(request, state);
+                }
+                catch (const std::exception& e) {
+                    response = {};
+                    response.result = ServeResponse::Result::Failed;
+                    response.warnings = std::string("[Server] Error: The request failed, ") + e.what() + ".\n";
+                }
+            }
+
+            if (!ServeProtocol::writeFrame(connection, ServeProtocol::encode(response))) break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            active.erase(connection);
+        }
+        ::close(connection);
+    }
+#endif
+}
+
+ServeResponse Server::handle(const ServeRequest& request, VmState& state) {
+    ServeResponse response;
+    std::shared_ptr<const CompiledProgram> program;
+
+    if (request.programId != 0 && request.code.empty()) {
+        response.programId = request.programId;
+        program = cache.find(request.programId);
+        if (!program) {
+            response.result = ServeResponse::Result::UnknownProgram;
+            return response;
+        }
+    }
+    else {
+        response.programId = ProgramCache::key(request);
+        program = cache.find(response.programId, &request.code);
+    }
+
+    if (!program) {
+        std::ostringstream compileWarnings;
+        StreamWarningSink sink(compileWarnings);
+        program = compile(request.code, request.isAwalang, request.legacy, sink);
+        sink.summary();
+        cache.insert(response.programId, request.code, program);
+        response.warnings = compileWarnings.str();
+    }
+
+    ExecutionLimits requestLimits;
+    requestLimits.maxSteps = lower(request.maxSteps, limits.maxSteps);
+    requestLimits.maxBubbles = static_cast<size_t>(lower(request.maxBubbles, limits.maxBubbles));
+    requestLimits.timeout = std::chrono::milliseconds(lower(request.timeoutMs, static_cast<uint64_t>(limits.timeout.count())));
+
+    state.reset();
+    state.setLimits(requestLimits);
+    StringInput input(request.input);
+    StringOutput output;
+    std::ostringstream warningStream;
+    StreamWarningSink warnings(warningStream);
+
+    response.status = AwaInterpreter::execute(*program, state, { input, output, warnings });
+    warnings.summary();
+    response.steps = state.executionStep;
+    response.output = std::move(output.output);
+    response.warnings += warningStream.str();
+    return response;
+}
+
+ServeClient::~ServeClient() {
+#ifndef _WIN32
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+bool ServeClient::connect(const std::string& path) {
+#ifndef _WIN32
+    sockaddr_un address;
+    if (!fillAddress(path, address)) return false;
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "[Server] Error: Unable to connect to " << path << ", " << std::strerror(errno) << "." << std::endl;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+#else
+    std::cerr << "[Server] Error: Serving needs Unix domain sockets, which this build does not support." << std::endl;
+    return false;
+#endif
+}
+
+bool ServeClient::run(const ServeRequest& request, ServeResponse& response) {
+    return fd >= 0 && ServeProtocol::writeFrame(fd, ServeProtocol::encode(request)) && ServeProtocol::readFrame(fd, buffer)
+        && ServeProtocol::decode(buffer, response);
+}
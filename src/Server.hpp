@@ -0,0 +1,194 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+/**
+* @brief A request to run a program on an awa server.
+*/
+struct ServeRequest {
+    uint64_t programId = 0;                     // A program compiled by an earlier request, the code is not needed then
+    std::string code;
+    std::optional<bool> isAwalang;              // Determined from the code if not set
+    bool legacy = false;                        // Awably is compiled to legacy Awalang
+    std::string input;
+    uint64_t maxSteps = 0;                      // 0 for the limits of the server
+    uint64_t maxBubbles = 0;
+    uint64_t timeoutMs = 0;
+};
+
+struct ServeResponse {
+    enum class Result : uint8_t {
+        Ran,
+        UnknownProgram,     // The program id is not, or no longer, in the cache, send the code again
+        Failed              // The request was malformed or its execution failed, warnings holds why
+    };
+
+    Result result = Result::Ran;
+    uint64_t programId = 0;                     // Send it instead of the code to run the same program again
+    ExecuteStatus status = ExecuteStatus::Finished;
+    uint64_t steps = 0;
+    std::string output;
+    std::string warnings;
+};
+
+/**
+* @brief The framed binary protocol between awa --client and awa --serve.
+* @details Every message is a frame of a 4 byte little-endian payload length followed by the payload.
+*   In the payload, integers are varints and strings a varint length followed by their bytes.
+*   A connection carries any number of requests, each answered by one response in order.
+*/
+class ServeProtocol {
+public:
+    static constexpr uint32_t MaxFrame = 64 << 20;
+
+    static std::string encode(const ServeRequest& request);
+    static std::string encode(const ServeResponse& response);
+
+    /**
+    * @return false if the payload is malformed.
+    */
+    static bool decode(std::string_view payload, ServeRequest& request);
+    static bool decode(std::string_view payload, ServeResponse& response);
+
+    /**
+    * @return false if the connection closed, timed out or sent a frame larger than MaxFrame.
+    */
+    static bool readFrame(int fd, std::string& payload);
+    static bool writeFrame(int fd, std::string_view payload);
+};
+
+/**
+* @brief Compiled programs by a hash of their code and how it is compiled, the least recently used one is dropped once full.
+* @details Safe to use from any number of threads.
+*/
+class ProgramCache {
+public:
+    explicit ProgramCache(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+    /**
+    * @brief The id of the program compiled from the code of the request, never 0.
+    */
+    static uint64_t key(const ServeRequest& request);
+
+    /**
+    * @brief Looks a program up and marks it as the most recently used.
+    *
+    * @param code If not null, the program is only returned if it was compiled from this code, in case of a hash collision.
+    */
+    std::shared_ptr<const CompiledProgram> find(uint64_t id, const std::string* code = nullptr);
+
+    void insert(uint64_t id, std::string code, std::shared_ptr<const CompiledProgram> program);
+
+    size_t size();
+
+private:
+    struct Entry {
+        uint64_t id;
+        std::string code;
+        std::shared_ptr<const CompiledProgram> program;
+    };
+
+    std::mutex mutex;
+    std::list<Entry> entries;                   // Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    const size_t capacity;
+};
+
+/**
+* @brief Long-lived server running programs for clients on a Unix domain socket.
+* @details Accepted connections are handed to a pool of workers, each serving one connection at a time on its own VmState.
+*   Programs are compiled once and kept in a ProgramCache. The limits of the server apply to every request,
+*   a request may only lower them. Connections idle for longer than IdleTimeout are closed.
+*/
+class Server {
+public:
+    /**
+    * @brief Compiles the code of a request, called by any number of workers at once.
+    */
+    using Compiler = std::function<std::shared_ptr<const CompiledProgram>(const std::string& code, std::optional<bool> isAwalang, bool legacy, WarningSink& warnings)>;
+
+    static constexpr std::chrono::seconds IdleTimeout{ 30 };
+
+    /**
+    * @param path The path of the socket.
+    * @param compile Compiles programs missing from the cache.
+    * @param threadCount The number of workers, 0 for one per hardware thread.
+    * @param limits The default and highest limits of every request.
+    * @param cacheSize The number of programs kept compiled.
+    */
+    Server(std::string path, Compiler compile, unsigned int threadCount = 0, const ExecutionLimits& limits = {}, size_t cacheSize = 256);
+    ~Server();
+
+    /**
+    * @brief Creates the socket, a stale socket left by a server that ended is replaced.
+    *
+    * @return false if the socket could not be created, the error is already printed.
+    */
+    bool listen();
+
+    /**
+    * @brief Serves connections until stop is set, then waits for the workers and removes the socket.
+    *
+    * @param stop Set from a signal handler or another thread.
+    */
+    void run(const std::atomic<bool>& stop);
+
+    unsigned int threads() const { return threadCount; }
+
+    /**
+    * @brief Runs one request on the state of a worker.
+    */
+    ServeResponse handle(const ServeRequest& request, VmState& state);
+
+private:
+    void serve();
+
+    const std::string path;
+    const Compiler compile;
+    unsigned int threadCount;
+    const ExecutionLimits limits;
+    ProgramCache cache;
+
+    int listener = -1;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<int> pending;                    // Accepted connections no worker serves yet
+    std::set<int> active;                       // Connections being served, shut down on stop
+    bool stopping = false;
+};
+
+/**
+* @brief Connection to an awa server.
+*/
+class ServeClient {
+public:
+    ServeClient() = default;
+    ~ServeClient();
+
+    ServeClient(const ServeClient&) = delete;
+    ServeClient& operator=(const ServeClient&) = delete;
+
+    /**
+    * @return false if the server is not reachable, the error is already printed.
+    */
+    bool connect(const std::string& path);
+
+    /**
+    * @brief Sends a request and waits for its response.
+    *
+    * @return false if the connection failed.
+    */
+    bool run(const ServeRequest& request, ServeResponse& response);
+
+private:
+    int fd = -1;
+    std::string buffer;
+};
@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+/**
+* @brief Vector keeping up to N elements inline, it only allocates once it grows beyond them.
+* @details Supports the subset of std::vector the interpreter uses. Iterators and references are invalidated
+*   by any growth, as well as by moving the vector while its elements are inline.
+*   Copies use a default constructed allocator, moves take the allocator along with the elements.
+*/
+template <typename T, size_t N, typename Allocator = std::allocator<T>>
+class SmallVector {
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    SmallVector() = default;
+
+    SmallVector(std::initializer_list<T> values) {
+        reserve(values.size());
+        for (const T& value : values) push_back(value);
+    }
+
+    SmallVector(const SmallVector& other) {
+        reserve(other.count);
+        std::uninitialized_copy(other.begin(), other.end(), elements);
+        count = other.count;
+    }
+
+    SmallVector(SmallVector&& other) noexcept {
+        take(std::move(other));
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            SmallVector copy(other);
+            release();
+            take(std::move(copy));
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            release();
+            take(std::move(other));
+        }
+        return *this;
+    }
+
+    ~SmallVector() {
+        release();
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return limit; }
+    bool empty() const { return count == 0; }
+    bool isInline() const { return elements == inlineElements(); }
+
+    T* data() { return elements; }
+    const T* data() const { return elements; }
+    T& operator[](size_t i) { return elements[i]; }
+    const T& operator[](size_t i) const { return elements[i]; }
+    T& front() { return elements[0]; }
+    const T& front() const { return elements[0]; }
+    T& back() { return elements[count - 1]; }
+    const T& back() const { return elements[count - 1]; }
+
+    iterator begin() { return elements; }
+    iterator end() { return elements + count; }
+    const_iterator begin() const { return elements; }
+    const_iterator end() const { return elements + count; }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    void reserve(size_t size) {
+        if (size > limit) grow(size);
+    }
+
+    void clear() {
+        std::destroy(begin(), end());
+        count = 0;
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (count == limit) {
+            // The argument may live in this vector, construct it before moving the elements
+            T value(std::forward<Args>(args)...);
+            grow(limit * 2);
+            return *new (elements + count++) T(std::move(value));
+        }
+        return *new (elements + count++) T(std::forward<Args>(args)...);
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() {
+        elements[--count].~T();
+    }
+
+    iterator insert(const_iterator position, const T& value) {
+        size_t index = position - begin();
+        emplace_back(value);
+        std::rotate(begin() + index, end() - 1, end());
+        return begin() + index;
+    }
+
+    template <typename InputIt>
+    iterator insert(const_iterator position, InputIt first, InputIt last) {
+        size_t index = position - begin();
+        size_t oldCount = count;
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>) {
+            reserve(count + static_cast<size_t>(std::distance(first, last)));
+        }
+        for (; first != last; ++first) emplace_back(*first);
+        std::rotate(begin() + index, begin() + oldCount, end());
+        return begin() + index;
+    }
+
+private:
+    T* inlineElements() { return reinterpret_cast<T*>(storage); }
+    const T* inlineElements() const { return reinterpret_cast<const T*>(storage); }
+
+    void grow(size_t size) {
+        size = std::max(size, limit * 2);
+        T* grown = allocator.allocate(size);
+        std::uninitialized_move(begin(), end(), grown);
+        std::destroy(begin(), end());
+        if (!isInline()) allocator.deallocate(elements, limit);
+
+        elements = grown;
+        limit = size;
+    }
+
+    void release() {
+        std::destroy(begin(), end());
+        if (!isInline()) allocator.deallocate(elements, limit);
+
+        elements = inlineElements();
+        count = 0;
+        limit = N;
+    }
+
+    /**
+    * @brief Takes the elements of another vector, this one must be empty and inline.
+    */
+    void take(SmallVector&& other) {
+        if (other.isInline()) {
+            std::uninitialized_move(other.begin(), other.end(), elements);
+            count = other.count;
+            other.clear();
+            return;
+        }
+
+        allocator = other.allocator;
+        elements = std::exchange(other.elements, other.inlineElements());
+        count = std::exchange(other.count, 0);
+        limit = std::exchange(other.limit, N);
+    }
+
+    [[no_unique_address]] Allocator allocator;
+    T* elements = inlineElements();
+    size_t count = 0;
+    size_t limit = N;
+    alignas(T) unsigned char storage[N * sizeof(T)];
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+* @brief Bounded lock-free queue between exactly one producer thread and one consumer thread.
+* @details The capacity is rounded up to a power of two. Each side caches the index of the other one,
+*   so the shared index is only read again when the queue looks full or empty.
+*   Waiting is left to the caller, which knows when to give up.
+*/
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots = std::make_unique<T[]>(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+    * @brief Called by the producer only.
+    *
+    * @return false if the queue is full, the item is left untouched then.
+    */
+    bool tryPush(T& item) {
+        const size_t tail = producer.tail.load(std::memory_order_relaxed);
+        if (tail - producer.cachedHead > mask) {
+            producer.cachedHead = consumer.head.load(std::memory_order_acquire);
+            if (tail - producer.cachedHead > mask) return false;
+        }
+
+        slots[tail & mask] = std::move(item);
+        producer.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * @brief Called by the consumer only.
+    *
+    * @return false if the queue is empty.
+    */
+    bool tryPop(T& item) {
+        const size_t head = consumer.head.load(std::memory_order_relaxed);
+        if (head == consumer.cachedTail) {
+            consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+            if (head == consumer.cachedTail) return false;
+        }
+
+        item = std::move(slots[head & mask]);
+        consumer.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Apart, so the producer and the consumer do not invalidate each other's cache line on every operation
+    struct alignas(64) Producer {
+        std::atomic<size_t> tail{ 0 };
+        size_t cachedHead = 0;
+    };
+
+    struct alignas(64) Consumer {
+        std::atomic<size_t> head{ 0 };
+        size_t cachedTail = 0;
+    };
+
+    Producer producer;
+    Consumer consumer;
+    std::unique_ptr<T[]> slots;
+    size_t mask;
+};
@@ -0,0 +1,244 @@
+#include "TimeTravel.hpp"
+#include <algorithm>
+
+TimeTravel::TimeTravel(std::shared_ptr<const CompiledProgram> program, const std::string& input, uint64_t snapshotInterval, WarningSink& warnings)
+    : program(std::move(program)), input(input), snapshotInterval(std::max<uint64_t>(1, snapshotInterval)), warnings(warnings) {
+    snapshots.push_back({ current.share(), 0 });
+}
+
+ExecuteStatus TimeTravel::forward(uint64_t steps) {
+    const uint64_t target = current.executionStep + steps;
+    status = ExecuteStatus::Yielded;
+
+    while (current.executionStep < target && status == ExecuteStatus::Yielded) {
+        const uint64_t nextSnapshot = (current.executionStep / snapshotInterval + 1) * snapshotInterval;
+        const uint64_t slice = std::min<uint64_t>({ target, nextSnapshot, current.executionStep + UINT32_MAX }) - current.executionStep;
+
+        status = AwaInterpreter::execute(*program, current, { input, written, warnings }, static_cast<unsigned int>(slice));
+        warnings.frontier = std::max(warnings.frontier, current.executionStep);
+
+        if (current.executionStep % snapshotInterval == 0 && current.executionStep > snapshots.back().state.executionStep) {
+            snapshots.push_back({ current.share(), written.output.size() });
+        }
+    }
+
+    return status;
+}
+
+void TimeTravel::seek(uint64_t step) {
+    if (step < current.executionStep) {
+        auto it = std::upper_bound(snapshots.begin(), snapshots.end(), step, [](uint64_t s, const Snapshot& snapshot) { return s < snapshot.state.executionStep; });
+        const Snapshot& snapshot = *std::prev(it);
+
+        current = snapshot.state.share();
+        written.output.resize(snapshot.outputSize);
+    }
+
+    forward(step - current.executionStep);
+}
+
+template <typename Predicate>
+std::optional<uint64_t> TimeTravel::findLast(uint64_t until, Predicate predicate, size_t* pc) {
+    StringOutput discarded;
+    NullWarningSink silent;
+
+    // Snapshots after the current step only exist if it was reached by going back
+    size_t k = std::upper_bound(snapshots.begin(), snapshots.end(), until, [](uint64_t s, const Snapshot& snapshot) { return s < snapshot.state.executionStep; }) - snapshots.begin();
+    while (k-- > 0) {
+        VmState replay = snapshots[k].state.share();
+        std::optional<uint64_t> found;
+
+        while (replay.executionStep < until) {
+            VmState::Registers before = replay.bubblePond;
+            size_t beforePc = replay.pc;
+            uint64_t beforeStep = replay.executionStep;
+
+            AwaInterpreter::execute(*program, replay, { input, discarded, silent }, 1);
+            discarded.output.clear();
+            if (replay.executionStep == beforeStep) break;
+
+            if (predicate(before, replay)) {
+                found = replay.executionStep;
+                if (pc) *pc = beforePc;
+            }
+            if (k + 1 < snapshots.size() && replay.executionStep >= snapshots[k + 1].state.executionStep) break;
+        }
+
+        if (found) return found;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<uint64_t> TimeTravel::lastVisit(int label) {
+    auto target = program->lblTable.find(label);
+    if (target == program->lblTable.end() || current.executionStep == 0) {
+        return std::nullopt;
+    }
+
+    // Both a lbl executed in order and a jmp to it leave the pc right after the label
+    const size_t position = target->second + 1;
+    return findLast(current.executionStep - 1, [position](const VmState::Registers&, const VmState& after) { return after.pc == position; });
+}
+
+std::optional<uint64_t> TimeTravel::lastChange(size_t registerIndex, size_t& pc) {
+    if (registerIndex >= current.bubblePond.size()) {
+        return std::nullopt;
+    }
+
+    return findLast(current.executionStep, [registerIndex](const VmState::Registers& before, const VmState& after) {
+        return before[registerIndex] != after.bubblePond[registerIndex];
+    }, &pc);
+}
+
+std::string TimeTravel::describeInstruction(size_t pc) const {
+    const std::vector<int>& data = program->data;
+    if (pc >= data.size()) {
+        return "end of program";
+    }
+
+    std::string text(awatismName(data[pc]));
+    auto parameter = [&](size_t offset) { return (pc + offset < data.size()) ? std::to_string(data[pc + offset]) : std::string("?"); };
+    switch (data[pc]) {
+    case blw:
+    case sbm:
+    case srn:
+    case jmp:
+        if (program->legacy) text += " " + parameter(1);
+        else text += " " + std::string((pc + 1 < data.size() && data[pc + 1]) ? "r" : "") + parameter(2);
+        break;
+    case lbl:
+        if (program->legacy) text += " " + parameter(1);
+        break;
+    case pop:
+        if (!program->legacy) text += " r" + parameter(1);
+        break;
+    case mov:
+        if (!program->legacy) text += " r" + parameter(2) + ", " + std::string((pc + 1 < data.size() && data[pc + 1]) ? "r" : "") + parameter(3);
+        break;
+    default:
+        break;
+    }
+    return text;
+}
+
+void TimeTravel::printWhere(std::ostream& out) const {
+    out << "[Step " << current.executionStep << "] ";
+    if (current.terminated) {
+        out << "terminated" << std::endl;
+    }
+    else {
+        out << "pc " << current.pc << ": " << describeInstruction(current.pc) << std::endl;
+    }
+}
+
+size_t TimeTravel::snapshotBytes() const {
+    size_t bytes = snapshots.capacity() * sizeof(Snapshot);
+    for (const Snapshot& snapshot : snapshots) {
+        bytes += snapshot.state.bubbleAbyss.capacity() * sizeof(Bubble);
+    }
+    return bytes;
+}
+
+int TimeTravel::run(std::istream& in, std::ostream& out) {
+    out << "AWA5.0 time travel debugger, snapshots every " << snapshotInterval << " steps, enter help for the commands." << std::endl;
+    printWhere(out);
+
+    std::string line;
+    while (out << "(awa) " << std::flush, std::getline(in, line)) {
+        std::istringstream iss(line);
+        std::string command, argument;
+        iss >> command >> argument;
+        if (command.empty()) continue;
+
+        uint64_t number = 1;
+        bool hasNumber = false;
+        if (!argument.empty()) {
+            try {
+                number = std::stoull(argument.substr(argument[0] == 'r' ? 1 : 0));
+                hasNumber = true;
+            }
+            catch (...) {
+                out << "Invalid argument " << argument << "." << std::endl;
+                continue;
+            }
+        }
+
+        if (command == "step" || command == "s") {
+            forward(number);
+            printWhere(out);
+        }
+        else if (command == "back" || command == "b") {
+            seek(current.executionStep - std::min(number, current.executionStep));
+            printWhere(out);
+        }
+        else if (command == "continue" || command == "c") {
+            forward(UINT64_MAX - current.executionStep);
+            printWhere(out);
+        }
+        else if (command == "goto" && hasNumber) {
+            seek(number);
+            printWhere(out);
+        }
+        else if (command == "back-to-label" && hasNumber) {
+            std::optional<uint64_t> step = lastVisit(static_cast<int>(number));
+            if (step) {
+                seek(*step);
+                printWhere(out);
+            }
+            else {
+                out << "Label " << number << " was not visited before this step." << std::endl;
+            }
+        }
+        else if (command == "last-change" && hasNumber) {
+            size_t pc = 0;
+            std::optional<uint64_t> step = lastChange(static_cast<size_t>(number), pc);
+            if (step) out << "r" << number << " last changed on step " << *step << " by pc " << pc << ": " << describeInstruction(pc) << std::endl;
+            else out << "r" << number << " has not changed up to this step." << std::endl;
+        }
+        else if (command == "where" || command == "w") {
+            printWhere(out);
+        }
+        else if (command == "stack") {
+            std::string text;
+            for (const Bubble& bubble : current.bubbleAbyss) {
+                if (!text.empty()) text += ' ';
+                formatBubble(bubble, text);
+            }
+            out << (text.empty() ? "(empty)" : text) << std::endl;
+        }
+        else if (command == "regs") {
+            for (size_t r = 0; r < current.bubblePond.size(); r++) {
+                out << "r" << r << "=" << current.bubblePond[r] << ((r % 8 == 7) ? "\n" : ", ");
+            }
+        }
+        else if (command == "output") {
+            out << written.output << std::endl;
+        }
+        else if (command == "info") {
+            out << snapshots.size() << " snapshots, about " << snapshotBytes() << " bytes, furthest step " << warnings.frontier << std::endl;
+        }
+        else if (command == "quit" || command == "q") {
+            break;
+        }
+        else if (command == "help") {
+            out << "step [n]            Execute n steps, 1 by default" << std::endl;
+            out << "back [n]            Go back n steps, 1 by default" << std::endl;
+            out << "continue            Execute until the program ends" << std::endl;
+            out << "goto <step>         Go to a step, forwards or backwards" << std::endl;
+            out << "back-to-label <l>   Go back to the last time the program passed label l" << std::endl;
+            out << "last-change <rN>    Find the step that last changed register rN" << std::endl;
+            out << "where               Print the step and the next instruction" << std::endl;
+            out << "stack, regs         Print the abyss or the pond" << std::endl;
+            out << "output              Print the output up to this step" << std::endl;
+            out << "info                Print the number and size of the snapshots" << std::endl;
+            out << "quit                Leave the debugger" << std::endl;
+        }
+        else {
+            out << "Unknown command " << line << ", enter help for the commands." << std::endl;
+        }
+    }
+
+    out << std::endl;
+    return 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "AwaInterpreter.hpp"
+
+/**
+* @brief Reverse debugger built on periodic snapshots and deterministic replay.
+* @details A snapshot of the VM is kept every snapshotInterval steps. Execution is deterministic given its input,
+*   so any earlier step is reached by restoring the nearest snapshot before it and replaying forward.
+*   Memory grows with steps / snapshotInterval instead of with every step, replays cost at most snapshotInterval steps.
+*/
+class TimeTravel {
+public:
+    /**
+    * @param program The program to be debugged.
+    * @param input The input of every read.
+    * @param snapshotInterval The number of steps between snapshots.
+    * @param warnings The sink receiving the warnings, each is reported once no matter how often its step is replayed.
+    */
+    TimeTravel(std::shared_ptr<const CompiledProgram> program, const std::string& input, uint64_t snapshotInterval, WarningSink& warnings);
+
+    /**
+    * @brief Executes up to the given number of steps.
+    *
+    * @return Yielded if all the steps were executed, otherwise why the execution stopped.
+    */
+    ExecuteStatus forward(uint64_t steps);
+
+    /**
+    * @brief Moves to a step, earlier steps are reached by replaying from the nearest snapshot.
+    */
+    void seek(uint64_t step);
+
+    /**
+    * @brief Finds the last step before the current one right after the given label, reached in order or by a jump.
+    */
+    std::optional<uint64_t> lastVisit(int label);
+
+    /**
+    * @brief Finds the last step up to the current one that changed a register.
+    *
+    * @param registerIndex The register, 0 to 15.
+    * @param pc Receives the position of the instruction that changed it.
+    */
+    std::optional<uint64_t> lastChange(size_t registerIndex, size_t& pc);
+
+    /**
+    * @brief Reads commands until the end of the input or quit, see help.
+    *
+    * @return The exit code.
+    */
+    int run(std::istream& in, std::ostream& out);
+
+    const VmState& state() const { return current; }
+    const std::string& output() const { return written.output; }
+    size_t snapshotCount() const { return snapshots.size(); }
+
+private:
+    struct Snapshot {
+        VmState state;
+        size_t outputSize;
+    };
+
+    /**
+    * @brief Warning sink dropping the warnings of steps that were already executed once.
+    */
+    class FrontierWarnings : public WarningSink {
+    public:
+        explicit FrontierWarnings(WarningSink& next) : next(next) {}
+
+        void warn(const Warning& warning) override {
+            if (warning.step >= frontier) next.warn(warning);
+        }
+
+        WarningSink& next;
+        uint64_t frontier = 0;
+    };
+
+    /**
+    * @brief Replays the steps before the current one backwards, one snapshot interval at a time, until the predicate matches.
+    * @details The predicate is called with the state before and after each step, the last matching step of the latest interval wins.
+    */
+    template <typename Predicate>
+    std::optional<uint64_t> findLast(uint64_t until, Predicate predicate, size_t* pc = nullptr);
+
+    std::string describeInstruction(size_t pc) const;
+    void printWhere(std::ostream& out) const;
+    size_t snapshotBytes() const;
+
+    std::shared_ptr<const CompiledProgram> program;
+    StringInput input;
+    uint64_t snapshotInterval;
+    FrontierWarnings warnings;
+
+    VmState current;
+    StringOutput written;
+    ExecuteStatus status = ExecuteStatus::Yielded;
+    std::vector<Snapshot> snapshots;            // Sorted by step, the first one is step 0
+};
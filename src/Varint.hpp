@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+* @brief Appends an unsigned integer in 7 bits per byte, lowest first, the high bit set on every byte but the last.
+*/
+inline void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+/**
+* @brief Appends the length of the bytes as a varint, followed by the bytes.
+*/
+inline void putBytes(std::string& out, std::string_view bytes) {
+    putVarint(out, bytes.size());
+    out += bytes;
+}
+
+/**
+* @brief Reads what putVarint and putBytes wrote, every read fails once the bytes run out.
+*/
+struct VarintReader {
+    std::string_view bytes;
+    size_t offset = 0;
+    bool failed = false;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (offset >= bytes.size()) break;
+
+            unsigned char c = static_cast<unsigned char>(bytes[offset++]);
+            value |= static_cast<uint64_t>(c & 0x7F) << shift;
+            if (!(c & 0x80)) return value;
+        }
+
+        failed = true;
+        return 0;
+    }
+
+    std::string_view take(uint64_t size) {
+        if (failed || size > bytes.size() - offset) {
+            failed = true;
+            return {};
+        }
+
+        std::string_view taken = bytes.substr(offset, size);
+        offset += size;
+        return taken;
+    }
+
+    /**
+    * @brief Reads bytes written by putBytes.
+    */
+    std::string_view lengthPrefixed() { return take(varint()); }
+
+    /**
+    * @return true if everything was read, and nothing failed.
+    */
+    bool done() const { return !failed && offset == bytes.size(); }
+};
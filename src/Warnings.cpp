@@ -0,0 +1,124 @@
+#include "Warnings.hpp"
+#include <iomanip>
+#include <sstream>
+
+std::string describe(const Warning& warning) {
+    if (!warning.detail.empty()) {
+        return warning.detail;
+    }
+
+    const std::string bubbles = " on a stack with " + std::to_string(warning.value) + " bubbles";
+    switch (warning.code) {
+    case WarningCode::PrintEmpty:
+        return "Print attempted to print an empty stack";
+    case WarningCode::PrintNumEmpty:
+        return "Print Num attempted to print an empty stack";
+    case WarningCode::ReadNoInput:
+        return "Read has no input to read";
+    case WarningCode::ReadNumNoInput:
+        return "Read Num has no input to read";
+    case WarningCode::BlowNoArgument:
+        return "Blow has no or insufficient valid argument";
+    case WarningCode::SubmergeEmpty:
+        return "Submerge attempted to submarge on an empty stack";
+    case WarningCode::SubmergeNoArgument:
+        return "Submerge has no or insufficient valid argument";
+    case WarningCode::PopNoArgument:
+        return "Pop has no valid argument";
+    case WarningCode::PopEmpty:
+        return "Pop attempted to pop on an empty stack";
+    case WarningCode::DuplicateEmpty:
+        return "Duplicate attempted to duplicate on an empty stack";
+    case WarningCode::SurroundDouble:
+        return "Surround attempted to surround a double bubble";
+    case WarningCode::SurroundNoArgument:
+        return "Surround has no or insufficient valid argument";
+    case WarningCode::MergeShortStack:
+        return "Merge attempted to merge" + bubbles;
+    case WarningCode::AddShortStack:
+        return "Add attempted to add" + bubbles;
+    case WarningCode::SubtractShortStack:
+        return "Subtract attempted to subtract" + bubbles;
+    case WarningCode::MultiplyShortStack:
+        return "Multiply attempted to multiply" + bubbles;
+    case WarningCode::DivideShortStack:
+        return "Division attempted to divide" + bubbles;
+    case WarningCode::LabelNoArgument:
+        return "Label has no valid argument";
+    case WarningCode::JumpMissingLabel:
+        return "Jump attempted to jump to a non-existing label " + std::to_string(warning.value);
+    case WarningCode::JumpNoArgument:
+        return "Jump has no valid argument";
+    case WarningCode::EqualShortStack:
+        return "Equal attempted to compare" + bubbles;
+    case WarningCode::LessShortStack:
+        return "Less Than attempted to compare" + bubbles;
+    case WarningCode::GreaterShortStack:
+        return "Greater Than attempted to compare" + bubbles;
+    case WarningCode::MoveInLegacy:
+        return "Move is not supported in legacy mode";
+    case WarningCode::MoveNoArgument:
+        return "Move has no or insufficient valid arguments";
+    case WarningCode::AwablerPlusPlus:
+        return "You're currently transpiling Awalang code under AWA5.0++, the code generated may lead to compatibility issues with other interpreters. Use the \"--legacy\" option for legacy Awabling. Find more details in the README";
+    default:
+        return "Undefined warning";
+    }
+}
+
+std::string format(const Warning& warning, uint64_t number) {
+    std::ostringstream oss;
+    if (warning.source == WarningSource::Interpreter) {
+        oss << "[AwaInterpreter] [" << std::setfill('0') << std::setw(4) << number << "] Warning: " << describe(warning) << " on step " << warning.step << ".";
+    }
+    else if (warning.pc != 0) {
+        oss << "[Awabler] [" << std::setfill('0') << std::setw(4) << number << "] Warning: " << describe(warning) << " on line " << warning.pc << ".";
+    }
+    else {
+        oss << "[Awabler] [" << std::setfill('0') << std::setw(4) << number << "] Warning: " << describe(warning) << ".";
+    }
+    return oss.str();
+}
+
+bool WarningLog::record(const Warning& warning) {
+    total++;
+    if (keepRecords) {
+        records.push_back(warning);
+    }
+
+    uint64_t key = (static_cast<uint64_t>(warning.source) << 63) | (static_cast<uint64_t>(warning.code) << 55) | (warning.pc & ((1ull << 55) - 1));
+    auto [it, inserted] = index.try_emplace(key, distinct.size());
+    if (inserted) {
+        distinct.push_back({ warning, 1 });
+        return true;
+    }
+
+    distinct[it->second].count++;
+    return false;
+}
+
+void WarningLog::clear() {
+    total = 0;
+    distinct.clear();
+    records.clear();
+    index.clear();
+}
+
+void StreamWarningSink::warn(const Warning& warning) {
+    if (record(warning) || verbose) {
+        os << format(warning, ++written) + '\n';
+    }
+}
+
+void StreamWarningSink::summary() {
+    if (verbose || written == total) {
+        return;
+    }
+
+    os << "[Warnings] " << total << " warnings in total, " << total - written << " repeated warnings were not shown:" << std::endl;
+    for (const Distinct& d : distinct) {
+        if (d.count > 1) {
+            os << "    " << std::setw(10) << std::setfill(' ') << d.count << "x " << describe(d.first) << ((d.first.source == WarningSource::Interpreter) ? " (instruction " : " (line ") << d.first.pc << ")" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+enum class WarningSource : uint8_t {
+    Interpreter,
+    Awabler
+};
+
+enum class WarningCode : uint8_t {
+    // Interpreter
+    PrintEmpty,
+    PrintNumEmpty,
+    ReadNoInput,
+    ReadNumNoInput,
+    BlowNoArgument,
+    SubmergeEmpty,
+    SubmergeNoArgument,
+    PopNoArgument,
+    PopEmpty,
+    DuplicateEmpty,
+    SurroundDouble,
+    SurroundNoArgument,
+    MergeShortStack,
+    AddShortStack,
+    SubtractShortStack,
+    MultiplyShortStack,
+    DivideShortStack,
+    LabelNoArgument,
+    JumpMissingLabel,
+    JumpNoArgument,
+    EqualShortStack,
+    LessShortStack,
+    GreaterShortStack,
+    MoveInLegacy,
+    MoveNoArgument,
+
+    // Awabler
+    AwablerPlusPlus,
+    UndefinedInstruction,
+    UndefinedToken,
+    MissingParameter,
+    UnexpectedParameter,
+    InvalidParameter
+};
+
+/**
+* @brief One warning record.
+* @details Interpreter warnings are described by their code, step, instruction index and value alone,
+*   Awabler warnings carry their message in detail.
+*/
+struct Warning {
+    WarningSource source;
+    WarningCode code;
+    uint64_t step;              // Execution step, 0 for the Awabler
+    size_t pc;                  // Instruction index, source line for the Awabler
+    int value = 0;              // Stack size or label, depending on the code
+    std::string detail{};       // Message of Awabler warnings
+};
+
+/**
+* @brief Formats the message of a warning, without prefix and location.
+*/
+std::string describe(const Warning& warning);
+
+/**
+* @brief Formats a warning as a numbered line.
+*/
+std::string format(const Warning& warning, uint64_t number);
+
+/**
+* @brief Destination of the warnings emitted during execution or transpilation.
+*/
+class WarningSink {
+public:
+    virtual ~WarningSink() = default;
+    virtual void warn(const Warning& warning) = 0;
+};
+
+/**
+* @brief Warning sink dropping every warning.
+*/
+class NullWarningSink : public WarningSink {
+public:
+    void warn(const Warning&) override {}
+};
+
+/**
+* @brief Warning sink aggregating records by (source, code, instruction).
+* @details Keeps the first occurrence and the count of each distinct warning, and every record if asked to.
+*/
+class WarningLog : public WarningSink {
+public:
+    struct Distinct {
+        Warning first;
+        uint64_t count;
+    };
+
+    /**
+    * @param keepRecords Keeps every warning in records, not only the distinct ones.
+    */
+    explicit WarningLog(bool keepRecords = false) : keepRecords(keepRecords) {}
+
+    void warn(const Warning& warning) override { record(warning); }
+
+    /**
+    * @brief Records a warning.
+    *
+    * @return true if it is the first occurrence of a distinct warning.
+    */
+    bool record(const Warning& warning);
+
+    void clear();
+
+    bool keepRecords;
+    uint64_t total = 0;
+    std::vector<Distinct> distinct;     // In order of first occurrence
+    std::vector<Warning> records;       // Only kept with keepRecords
+
+private:
+    std::unordered_map<uint64_t, size_t> index;
+};
+
+/**
+* @brief Warning sink writing warnings to a std::ostream, std::cerr by default.
+* @details Only the first occurrence of each distinct warning is written unless verbose, summary() reports the rest.
+*   The warnings are written as they come and not kept, only their counts are.
+*/
+class StreamWarningSink : public WarningLog {
+public:
+    explicit StreamWarningSink(std::ostream& os = std::cerr, bool verbose = false) : verbose(verbose), os(os) {}
+
+    void warn(const Warning& warning) override;
+
+    /**
+    * @brief Writes the counts of the repeated warnings that were not written.
+    */
+    void summary();
+
+    bool verbose;
+
+private:
+    std::ostream& os;
+    uint64_t written = 0;
+};
@@ -4,31 +4,101 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <cstdint>
+#include <stdexcept>
 
 struct ParsedArguments {
     std::string awa;
     std::string input;
     bool interactiveMode = false;
     bool debugMode = false;
+    bool allWarnings = false;
+    bool emitAwalang = false;
+    bool disassemble = false;
+    bool characters = false;
     std::optional<bool> isAwalang = std::nullopt;
     std::optional<std::string> filePath = std::nullopt;
     std::string executableName;
     bool valid = true;
 	bool legacyMode = false;
+    std::optional<std::string> batchPath = std::nullopt;
+    unsigned int threads = 0;
+    uint64_t maxSteps = 0;
+    uint64_t maxBubbles = 0;
+    uint64_t timeoutMs = 0;
+    std::optional<std::string> checkpointPath = std::nullopt;
+    uint64_t checkpointEvery = 0;
+    std::optional<std::string> resumePath = std::nullopt;
+    bool timeTravel = false;
+    uint64_t snapshotEvery = 10000;
+    bool optimize = false;
+    bool lockstep = false;
+    std::optional<std::string> servePath = std::nullopt;
+    std::optional<std::string> clientPath = std::nullopt;
 };
 
+/**
+* @brief Parses the argument following an option as a number.
+*
+* @return true if the number was parsed, false if it is missing or invalid, the error is already printed.
+*/
+inline bool parse_number(int argc, char* argv[], int& i, const std::string& option, uint64_t& target) {
+    if (i + 1 >= argc) {
+        std::cerr << "[ArgumentParser] Error: " << option << " requires an argument." << std::endl;
+        return false;
+    }
+
+    try {
+        size_t end = 0;
+        std::string value = argv[++i];
+        target = std::stoull(value, &end);
+        if (end != value.size()) throw std::invalid_argument(value);
+    }
+    catch (...) {
+        std::cerr << "[ArgumentParser] Error: " << option << " requires a number." << std::endl;
+        return false;
+    }
+    return true;
+}
+
 inline void print_usage(const std::string& executableName) {
     std::cerr << "Usage: " << executableName << " [Options] --interactive" << std::endl;
     std::cerr << "       " << executableName << " [Options] <Awalang | Awably code>" << std::endl;
     std::cerr << "       " << executableName << " [Options] --file <Path>" << std::endl;
+    std::cerr << "       " << executableName << " [Options] --time-travel [--file <Path> | <Awalang | Awably code>]" << std::endl;
+    std::cerr << "       " << executableName << " [Options] --batch <Manifest> [--file <Path> | <Awalang | Awably code>]" << std::endl;
+    std::cerr << "       " << executableName << " [Options] --serve <Socket>" << std::endl;
+    std::cerr << "       " << executableName << " [Options] --client <Socket> [--file <Path> | <Awalang | Awably code>]" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Options: " << std::endl;
-    std::cerr << "       " << " --interactive            Enter interactive mode(not implemented)" << std::endl;
+    std::cerr << "       " << " --interactive            Enter interactive mode, Awably is executed line by line on one VM" << std::endl;
     std::cerr << "       " << " -I,  --input             Use the next argument as input for all reads" << std::endl;
     std::cerr << "       " << " -Al, --awalang           Enforce interpreter to treat inputs as Awalang" << std::endl;
     std::cerr << "       " << " -Ab, --awably            Enforce interpreter to treat inputs as Awably" << std::endl;
     std::cerr << "       " << " -L,  --legacy            Enforce Awabler to generate legacy Awalang" << std::endl;
+    std::cerr << "       " << " -E,  --emit-awalang      Print the code as Awalang instead of executing it" << std::endl;
+    std::cerr << "       " << " -X,  --disassemble       Print the Awalang code as Awably instead of executing it" << std::endl;
+    std::cerr << "       " << " -C,  --characters        Disassemble blown values as S(x) characters where possible" << std::endl;
     std::cerr << "       " << " -D,  --debug             Generate extra information on the program" << std::endl;
+    std::cerr << "       " << " -W,  --all-warnings      Log every warning, instead of the first of each and a summary at exit" << std::endl;
+    std::cerr << "       " << " -O,  --optimize          Turn AWA5.0++ register operands holding constants into immediates and remove dead mov," << std::endl;
+    std::cerr << "       " << "                          then report what was changed" << std::endl;
+    std::cerr << "       " << " -B,  --batch             Run every job in the manifest, one job per line, as <Program path><Tab><Input>," << std::endl;
+    std::cerr << "       " << "                          or as <Input> when a program is given" << std::endl;
+    std::cerr << "       " << "      --lockstep          Run --batch jobs of one legacy program in lockstep groups of 64 inputs, instead of on threads" << std::endl;
+    std::cerr << "       " << " -T,  --threads           Number of worker threads for --batch, --serve and the Awabler, defaults to one per hardware thread" << std::endl;
+    std::cerr << "       " << "      --max-steps         Stop the execution after about this many steps" << std::endl;
+    std::cerr << "       " << "      --max-bubbles       Stop the execution once the abyss holds more bubbles than this" << std::endl;
+    std::cerr << "       " << "      --timeout           Stop the execution after this many milliseconds" << std::endl;
+    std::cerr << "       " << "      --checkpoint        Write checkpoints of the execution to the path, on SIGUSR1 and at the interval" << std::endl;
+    std::cerr << "       " << "      --checkpoint-every  Write a checkpoint every this many steps" << std::endl;
+    std::cerr << "       " << "      --resume            Continue the execution of the same program from the checkpoint at the path," << std::endl;
+    std::cerr << "       " << "                          later checkpoints go to the same path unless --checkpoint is given" << std::endl;
+    std::cerr << "       " << "      --time-travel       Debug the program with commands from the standard input, steps can be undone" << std::endl;
+    std::cerr << "       " << "      --snapshot-every    Keep a snapshot for --time-travel every this many steps, 10000 by default" << std::endl;
+    std::cerr << "       " << "      --serve             Run programs sent to the Unix domain socket at the path, keeping them compiled," << std::endl;
+    std::cerr << "       " << "                          the limits given apply to every request" << std::endl;
+    std::cerr << "       " << "      --client            Run the program on the server at the socket instead of in this process" << std::endl;
     std::cerr << "       " << " -H,  --help              Display this message" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Examples: " << std::endl;
@@ -67,6 +137,9 @@ inline ParsedArguments parse_arguments(int argc, char* argv[]) {
         else if (arg == "--interactive") {
             args.interactiveMode = true;
         }
+        else if (arg == "--time-travel") {
+            args.timeTravel = true;
+        }
         else if (arg == "-L" || arg == "--legacy") {
             args.legacyMode = true;
 		}
@@ -91,6 +164,24 @@ inline ParsedArguments parse_arguments(int argc, char* argv[]) {
         else if (arg == "-D" || arg == "--debug") {
             args.debugMode = true;
         }
+        else if (arg == "-E" || arg == "--emit-awalang") {
+            args.emitAwalang = true;
+        }
+        else if (arg == "-X" || arg == "--disassemble") {
+            args.disassemble = true;
+        }
+        else if (arg == "-C" || arg == "--characters") {
+            args.characters = true;
+        }
+        else if (arg == "-W" || arg == "--all-warnings") {
+            args.allWarnings = true;
+        }
+        else if (arg == "-O" || arg == "--optimize") {
+            args.optimize = true;
+        }
+        else if (arg == "--lockstep") {
+            args.lockstep = true;
+        }
         else if (arg == "--file") {
             if (i + 1 < argc) {
                 args.filePath = argv[++i];
@@ -103,6 +194,48 @@ inline ParsedArguments parse_arguments(int argc, char* argv[]) {
                 return args;
             }
         }
+        else if (arg == "-B" || arg == "--batch") {
+            if (i + 1 < argc) {
+                args.batchPath = argv[++i];
+            }
+            else {
+                std::cerr << "[ArgumentParser] Error: --batch requires a path argument." << std::endl;
+                print_usage(args.executableName);
+                args.valid = false;
+
+                return args;
+            }
+        }
+        else if (arg == "--checkpoint" || arg == "--resume" || arg == "--serve" || arg == "--client") {
+            if (i + 1 < argc) {
+                std::optional<std::string>& target = (arg == "--checkpoint") ? args.checkpointPath : (arg == "--resume") ? args.resumePath
+                    : (arg == "--serve") ? args.servePath : args.clientPath;
+                target = argv[++i];
+            }
+            else {
+                std::cerr << "[ArgumentParser] Error: " << arg << " requires a path argument." << std::endl;
+                print_usage(args.executableName);
+                args.valid = false;
+
+                return args;
+            }
+        }
+        else if (arg == "-T" || arg == "--threads" || arg == "--max-steps" || arg == "--max-bubbles" || arg == "--timeout" || arg == "--checkpoint-every" || arg == "--snapshot-every") {
+            uint64_t value = 0;
+            if (!parse_number(argc, argv, i, arg, value)) {
+                print_usage(args.executableName);
+                args.valid = false;
+
+                return args;
+            }
+
+            if (arg == "--max-steps") args.maxSteps = value;
+            else if (arg == "--max-bubbles") args.maxBubbles = value;
+            else if (arg == "--timeout") args.timeoutMs = value;
+            else if (arg == "--checkpoint-every") args.checkpointEvery = value;
+            else if (arg == "--snapshot-every") args.snapshotEvery = value;
+            else args.threads = static_cast<unsigned int>(value);
+        }
         else if (arg.starts_with("-")) {
             std::cerr << "[ArgumentParser] Error: Unknown option: " << arg << std::endl;
             print_usage(args.executableName);
@@ -1,6 +1,17 @@
 ﻿#include "argparse.hpp"
 #include "AwaInterpreter.hpp"
 #include "Awabler.hpp"
+#include "BatchRunner.hpp"
+#include "Lockstep.hpp"
+#include "Pipeline.hpp"
+#include "AsyncOutput.hpp"
+#include "Server.hpp"
+#include "Disassembler.hpp"
+#include "Repl.hpp"
+#include "Checkpoint.hpp"
+#include "TimeTravel.hpp"
+#include "Optimizer.hpp"
+#include <csignal>
 #include <unordered_set>
 #include <array>
 
@@ -105,7 +116,7 @@ static void writeStacktrace(const std::vector<StacktraceEntry>& stacktrace, bool
             std::string stackLine;
             for (const Bubble& bubble : entry.stack) {
                 if (isDouble(bubble)) {
-                    BubbleVector list = getList(bubble);
+                    const BubbleVector& list = getList(bubble);
                     for (size_t i = 0; i < list.size(); i++) {
                         if (i == 0) {
                             stackLine.append(" (");
@@ -138,7 +149,7 @@ static void writeStacktrace(const std::vector<StacktraceEntry>& stacktrace, bool
                 Bubble bubble = stack[p];
 
                 if (isDouble(bubble)) {
-                    BubbleVector list = getList(bubble);
+                    const BubbleVector& list = getList(bubble);
                     for (size_t i = 0; i < list.size(); i++) {
                         if (i == 0) {
                             line.append(" (");
@@ -189,6 +200,377 @@ static void writeStacktrace(const std::vector<StacktraceEntry>& stacktrace, bool
     ofs.close();
 }
 
+/**
+* @brief Reads a whole file into a string.
+*
+* @param path The path of the file.
+* @param contents Receives the contents of the file.
+*
+* @return true if the file was read, false otherwise.
+*/
+static bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: Unable to read " << path << std::endl;
+
+        return false;
+    }
+
+    contents.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return true;
+}
+
+/**
+* @brief Filters the code and transpiles it into Awalang if it is Awably.
+*
+* @param awa The code to be prepared.
+* @param isAwalang Whether the code is Awalang or not, determined from the code if not set.
+* @param debugMode Whether to print the intermediate code.
+* @param threadCount The number of threads the Awabler may use, 0 for one per hardware thread.
+*
+* @return The Awalang code.
+*/
+static std::string prepareCode(std::string awa, std::optional<bool> isAwalang, bool debugMode, unsigned int threadCount) {
+    if (!isAwalang.has_value()) {
+        isAwalang = determineAwaType(awa);
+    }
+    filterInput(awa, isAwalang);
+
+    if (debugMode) std::cout << awa << std::endl << std::string(100, '-') << std::endl;
+
+    if (!isAwalang.value()) {
+        if (!Awabler::legacy) Awabler::warnings->warn({ WarningSource::Awabler, WarningCode::AwablerPlusPlus, 0, 0 });
+
+		awa = Awabler::convertCode(awa, threadCount);
+        
+		if (debugMode) std::cout << awa << std::endl << std::string(100, '-') << std::endl;
+    }
+
+    return awa;
+}
+
+/**
+* @brief Filters and compiles the code without printing it, with the Awabler settings given instead of taken from Awabler.
+*
+* @param awa The code to be compiled.
+* @param isAwalang Whether the code is Awalang or not, determined from the code if not set.
+* @param legacy Whether Awably is compiled to legacy Awalang.
+* @param warnings The sink receiving the warnings of the Awabler.
+*
+* @return The compiled program.
+*/
+static std::shared_ptr<const CompiledProgram> compileCode(std::string awa, std::optional<bool> isAwalang, bool legacy, WarningSink& warnings) {
+    if (!isAwalang.has_value()) {
+        isAwalang = determineAwaType(awa);
+    }
+    filterInput(awa, isAwalang);
+
+    if (isAwalang.value()) {
+        return AwaInterpreter::compile(awa);
+    }
+
+    if (!legacy) warnings.warn({ WarningSource::Awabler, WarningCode::AwablerPlusPlus, 0, 0 });
+
+    return AwaInterpreter::compileAwably(awa, legacy, warnings);
+}
+
+/**
+* @brief Filters and compiles the code, Awably is compiled directly unless its Awalang is printed for debugging.
+*
+* @param awa The code to be compiled.
+* @param isAwalang Whether the code is Awalang or not, determined from the code if not set.
+* @param debugMode Whether to print the intermediate code.
+* @param threadCount The number of threads the Awabler may use, 0 for one per hardware thread.
+*
+* @return The compiled program.
+*/
+static std::shared_ptr<const CompiledProgram> compileCode(std::string awa, std::optional<bool> isAwalang, bool debugMode, unsigned int threadCount) {
+    if (debugMode) {
+        return AwaInterpreter::compile(prepareCode(std::move(awa), isAwalang, debugMode, threadCount));
+    }
+
+    return compileCode(std::move(awa), isAwalang, Awabler::legacy, *Awabler::warnings);
+}
+
+/**
+* @brief Optimizes the program if --optimize is given and reports what was changed on std::cerr.
+*
+* @param program The program to be optimized.
+* @param args The parsed arguments.
+*
+* @return The program to run.
+*/
+static std::shared_ptr<const CompiledProgram> optimizeProgram(std::shared_ptr<const CompiledProgram> program, const ParsedArguments& args) {
+    if (!args.optimize) {
+        return program;
+    }
+
+    OptimizationReport report;
+    program = Optimizer::optimize(std::move(program), report);
+    report.print(std::cerr);
+
+    return program;
+}
+
+/**
+* @brief Disassembles Awalang into Awably on std::cout, streaming files in chunks.
+*
+* @param args The parsed arguments, the code is read from --file or given directly.
+*
+* @return The exit code.
+*/
+static int runDisassembler(const ParsedArguments& args) {
+    Disassembler disassembler(std::cout, args.characters);
+    if (args.filePath) {
+        std::ifstream file(*args.filePath, std::ios::in | std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: Unable to read " << *args.filePath << std::endl;
+
+            return 1;
+        }
+
+        std::string chunk(1 << 20, '\0');
+        while (file.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || file.gcount() > 0) {
+            disassembler.feed(std::string_view(chunk.data(), static_cast<size_t>(file.gcount())));
+        }
+    }
+    else {
+        disassembler.feed(args.awa);
+    }
+    disassembler.finish();
+    std::cout << std::flush;
+
+    return 0;
+}
+
+/**
+* @brief Checks whether an execution was stopped by one of its limits.
+*/
+static bool isLimit(ExecuteStatus status) {
+    return status == ExecuteStatus::StepLimit || status == ExecuteStatus::MemoryLimit || status == ExecuteStatus::Timeout;
+}
+
+static volatile std::sig_atomic_t checkpointRequested = 0;
+
+/**
+* @brief Output sink writing to std::cout and counting the bytes, so a checkpoint knows its output position.
+*/
+class CountingOutput : public OutputSink {
+public:
+    void write(std::string_view text) override {
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+        bytes += text.size();
+    }
+
+    uint64_t bytes = 0;
+};
+
+/**
+* @brief Runs a program with checkpoints, from the start or resumed from a checkpoint.
+* @details The execution runs in slices, a checkpoint is taken at the end of a slice once the interval is reached or SIGUSR1 was received.
+*
+* @param program The program to be executed.
+* @param input The input of every read, replaced by the input saved in the checkpoint when resuming.
+* @param args The parsed arguments.
+* @param limits The limits of the execution, the steps count from the start of the program.
+* @param warnings The sink receiving the warnings.
+*
+* @return The exit code.
+*/
+static int runCheckpointed(std::shared_ptr<const CompiledProgram> program, std::string input, const ParsedArguments& args, const ExecutionLimits& limits, WarningSink& warnings) {
+    VmState state;
+    state.setLimits(limits);
+    CountingOutput output;
+
+    if (args.resumePath) {
+        std::string bytes, error;
+        if (!readFile(*args.resumePath, bytes)) {
+            return 1;
+        }
+        if (!Checkpoint::deserialize(bytes, *program, state, input, output.bytes, error)) {
+            std::cerr << "[Checkpoint] Error: " << error << ", unable to resume from " << *args.resumePath << "." << std::endl;
+            return 1;
+        }
+        std::cerr << "[Checkpoint] Resuming on step " << state.executionStep << ", the output continues after byte " << output.bytes << "." << std::endl;
+    }
+
+    Checkpointer checkpointer(args.checkpointPath ? *args.checkpointPath : *args.resumePath);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, [](int) { checkpointRequested = 1; });
+#endif
+
+    // Without an interval, slices only serve to notice the signal
+    const unsigned int sliceSteps = static_cast<unsigned int>(std::min<uint64_t>(args.checkpointEvery ? args.checkpointEvery : 1 << 20, 1u << 30));
+    uint64_t nextCheckpoint = args.checkpointEvery ? state.executionStep + args.checkpointEvery : UINT64_MAX;
+
+    StringInput inputSource(input);
+    if (!args.resumePath) std::cout << "Output:" << std::endl;
+
+    ExecuteStatus status;
+    while ((status = AwaInterpreter::execute(*program, state, { inputSource, output, warnings }, sliceSteps)) == ExecuteStatus::Yielded) {
+        if (state.executionStep >= nextCheckpoint || checkpointRequested) {
+            if (checkpointer.save(*program, state, input, output.bytes)) {
+                checkpointRequested = 0;
+                if (args.checkpointEvery) nextCheckpoint = state.executionStep + args.checkpointEvery;
+            }
+        }
+    }
+    checkpointer.wait();
+
+    std::cout << std::endl;
+    if (isLimit(status)) {
+        std::cerr << "[AwaInterpreter] Error: Execution stopped on step " << state.executionStep << ", " << describe(status) << "." << std::endl;
+    }
+
+    return isLimit(status) ? 2 : 0;
+}
+
+/**
+* @brief Runs every job of a batch manifest and prints the outputs in manifest order, one line per job.
+*
+* @param args The parsed arguments, a program given by --file or directly applies to every line of the manifest.
+* @param limits The limits of every job.
+*
+* @return The exit code.
+*/
+static int runBatch(const ParsedArguments& args, const ExecutionLimits& limits) {
+    std::string manifest;
+    if (!readFile(*args.batchPath, manifest)) {
+        return 1;
+    }
+
+    std::shared_ptr<const CompiledProgram> sharedProgram;
+    if (args.filePath) {
+        std::string awa;
+        if (!readFile(*args.filePath, awa)) {
+            return 1;
+        }
+        sharedProgram = optimizeProgram(compileCode(awa, args.isAwalang, false, args.threads), args);
+    }
+    else if (!args.awa.empty()) {
+        sharedProgram = optimizeProgram(compileCode(args.awa, args.isAwalang, false, args.threads), args);
+    }
+
+    std::map<std::string, std::shared_ptr<const CompiledProgram>> programs;
+    std::vector<BatchJob> jobs;
+    std::istringstream iss(manifest);
+    std::string line;
+    while (std::getline(iss, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        if (sharedProgram) {
+            jobs.push_back({ sharedProgram, line });
+            continue;
+        }
+
+        if (line.empty()) continue;
+
+        size_t tab = line.find('\t');
+        std::string path = line.substr(0, tab);
+        std::string input = (tab == std::string::npos) ? "" : line.substr(tab + 1);
+
+        auto it = programs.find(path);
+        if (it == programs.end()) {
+            std::string awa;
+            if (!readFile(path, awa)) {
+                return 1;
+            }
+            it = programs.emplace(path, optimizeProgram(compileCode(awa, args.isAwalang, false, args.threads), args)).first;
+        }
+        jobs.push_back({ it->second, input });
+    }
+
+    bool limitHit = false;
+    auto emit = [&](BatchResult& result) {
+        if (!result.warnings.empty()) std::cerr << result.warnings;
+        if (isLimit(result.status)) {
+            limitHit = true;
+            std::cerr << "[BatchRunner] Error: Job " << result.index + 1 << " stopped on step " << result.steps << ", " << describe(result.status) << "." << std::endl;
+        }
+        std::cout << result.output << '\n';
+    };
+
+    if (args.lockstep && sharedProgram) {
+        std::vector<std::string> inputs;
+        inputs.reserve(jobs.size());
+        for (BatchJob& job : jobs) inputs.push_back(std::move(job.input));
+
+        LockstepRunner(limits).run(*sharedProgram, inputs, emit);
+    }
+    else {
+        if (args.lockstep) std::cerr << "[BatchRunner] Error: --lockstep needs one program for every job, the jobs run on threads." << std::endl;
+        BatchRunner(args.threads, limits).run(jobs, emit);
+    }
+    std::cout << std::flush;
+
+    return limitHit ? 2 : 0;
+}
+
+static std::atomic<bool> stopRequested{ false };       // Lock-free, so the signal handlers may set it
+
+/**
+* @brief Serves run requests on the socket until SIGINT or SIGTERM.
+*
+* @param args The parsed arguments, --threads sets the number of workers.
+* @param limits The default and highest limits of every request.
+*
+* @return The exit code.
+*/
+static int runServer(const ParsedArguments& args, const ExecutionLimits& limits) {
+    Server server(*args.servePath, [](const std::string& code, std::optional<bool> isAwalang, bool legacy, WarningSink& warnings) { return compileCode(code, isAwalang, legacy, warnings); },
+        args.threads, limits);
+    if (!server.listen()) {
+        return 1;
+    }
+
+    std::signal(SIGINT, [](int) { stopRequested = true; });
+    std::signal(SIGTERM, [](int) { stopRequested = true; });
+    std::cerr << "[Server] Serving on " << *args.servePath << " with " << server.threads() << " workers." << std::endl;
+    server.run(stopRequested);
+
+    return 0;
+}
+
+/**
+* @brief Runs the code on the server at the socket and prints the result like a run in this process.
+* @details The warnings are printed after the output, as they arrive together.
+*
+* @return The exit code.
+*/
+static int runClient(const ParsedArguments& args, const std::string& awa) {
+    ServeClient client;
+    if (!client.connect(*args.clientPath)) {
+        return 1;
+    }
+
+    ServeRequest request;
+    request.code = awa;
+    request.isAwalang = args.isAwalang;
+    request.legacy = args.legacyMode;
+    request.input = args.input;
+    request.maxSteps = args.maxSteps;
+    request.maxBubbles = args.maxBubbles;
+    request.timeoutMs = args.timeoutMs;
+
+    ServeResponse response;
+    if (!client.run(request, response)) {
+        std::cerr << "[Server] Error: The server at " << *args.clientPath << " did not answer." << std::endl;
+        return 1;
+    }
+    if (response.result != ServeResponse::Result::Ran) {
+        std::cerr << response.warnings;
+        return 1;
+    }
+
+    std::cout << "Output:" << std::endl << response.output << std::endl;
+    std::cerr << response.warnings;
+    if (isLimit(response.status)) {
+        std::cerr << "[AwaInterpreter] Error: Execution stopped on step " << response.steps << ", " << describe(response.status) << "." << std::endl;
+    }
+
+    return isLimit(response.status) ? 2 : 0;
+}
+
 int main(int argc, char* argv[]) {
     auto args = parse_arguments(argc, argv);
     if (!args.valid) return 1;
@@ -202,45 +584,120 @@ int main(int argc, char* argv[]) {
     std::optional<std::string> filePath = args.filePath;
     std::string executableName = args.executableName;
 
+    StreamWarningSink warnings(std::cerr, args.allWarnings);
+
     Awabler::verbose = debugMode;
     Awabler::legacy = legacyMode;
+    Awabler::warnings = &warnings;
 
-    if (filePath) {
-        std::ifstream file(*filePath, std::ios::in | std::ios::binary);
-        if (!file) {
-            std::cerr << "Error: Unable to read " << *filePath << std::endl;
+    ExecutionLimits limits;
+    limits.maxSteps = args.maxSteps;
+    limits.maxBubbles = static_cast<size_t>(args.maxBubbles);
+    limits.timeout = std::chrono::milliseconds(args.timeoutMs);
+
+    if (args.disassemble) {
+        return runDisassembler(args);
+    }
+
+    if (interactiveMode) {
+        Awabler::verbose = false;
+        if (!Awabler::legacy) Awabler::warnings->warn({ WarningSource::Awabler, WarningCode::AwablerPlusPlus, 0, 0 });
+
+        Repl repl(input, limits, warnings);
+        return repl.run(std::cin, std::cout, true);
+    }
+
+    if (args.batchPath) {
+        Awabler::verbose = false;
+        return runBatch(args, limits);
+    }
+
+    if (args.servePath) {
+        Awabler::verbose = false;
+        return runServer(args, limits);
+    }
 
+    if (filePath) {
+        if (!readFile(*filePath, awa)) {
             return 1;
         }
+    }
 
-        std::string fileContents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        awa = fileContents;
+    if (args.clientPath) {
+        return runClient(args, awa);
     }
 
-    if (isAwalang.has_value()) {
-		filterInput(awa, isAwalang);
+    if (args.emitAwalang) {
+        std::cout << prepareCode(awa, isAwalang, false, args.threads) << std::endl;
+        warnings.summary();
+
+        return 0;
     }
-    else {
+
+    if (args.timeTravel) {
+        TimeTravel debugger(compileCode(awa, isAwalang, false, args.threads), input, args.snapshotEvery, warnings);
+        int exitCode = debugger.run(std::cin, std::cout);
+        warnings.summary();
+
+        return exitCode;
+    }
+
+    if (args.checkpointPath || args.resumePath) {
+        int exitCode = runCheckpointed(compileCode(awa, isAwalang, false, args.threads), input, args, limits, warnings);
+        warnings.summary();
+
+        return exitCode;
+    }
+
+    if (!isAwalang.has_value()) {
         isAwalang = determineAwaType(awa);
-        filterInput(awa, isAwalang);
     }
 
-    if (debugMode) std::cout << awa << std::endl << std::string(100, '-') << std::endl;
+    if (!debugMode) {
+        // Awalang starts running while the rest of it is still decoded, unless it is optimized first
+        std::shared_ptr<const CompiledProgram> program;
+        if (!isAwalang.value() || args.optimize) {
+            program = optimizeProgram(compileCode(awa, isAwalang, false, args.threads), args);
+        }
 
-    if (!isAwalang.value()) {
-        if (!legacyMode) std::cerr << "[Awabler] [0001] Warning: You're currently transpiling Awalang code under AWA5.0++, the code generated may lead to compatibility issues with other interpreters. Use the \"--legacy\" option for legacy Awabling. Find more details in the README." << std::endl;
+        VmState state;
+        state.setLimits(limits);
+        StringInput inputSource(input);
+        ExecuteStatus status;
+
+        std::cout << "Output:" << std::endl;
+        {
+            // The output is written by a thread of its own, a warning waits for the output before it
+            AsyncOutput output;
+            std::ostream* tied = std::cerr.tie(&output.flushing());
+            VmIo io{ inputSource, output, warnings };
+            status = program ? AwaInterpreter::execute(*program, state, io) : Pipeline::run(awa, state, io, true);
+            output.close();
+            std::cerr.tie(tied);
+        }
+        std::cout << std::endl;
 
-		awa = Awabler::convertCode(awa);
-        
-		if (debugMode) std::cout << awa << std::endl << std::string(100, '-') << std::endl;
+        if (isLimit(status)) {
+            std::cerr << "[AwaInterpreter] Error: Execution stopped on step " << state.executionStep << ", " << describe(status) << "." << std::endl;
+        }
+
+        warnings.summary();
+
+        return isLimit(status) ? 2 : 0;
     }
 
     AwaInterpreter interpreter;
-    std::pair<std::vector<StacktraceEntry>, bool> info = interpreter.run(awa, input, debugMode);
+    RunResult info = interpreter.run(optimizeProgram(compileCode(awa, isAwalang, debugMode, args.threads), args), input, debugMode, limits, &warnings);
 
     std::cout << std::endl;
 
-    if (debugMode) writeStacktrace(info.first, info.second);
+    if (isLimit(info.status)) {
+        std::cerr << "[AwaInterpreter] Error: Execution stopped on step " << info.steps << ", " << describe(info.status) << "." << std::endl;
+    }
+
+    warnings.summary();
 
-    return 0;
+    if (debugMode) writeStacktrace(info.stacktrace, info.legacy);
+
+    return isLimit(info.status) ? 2 : 0;
 }
\ No newline at end of file